@@ -0,0 +1,32 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * PHP-CPP replacement for building library classes without PHP.
+ *
+ * Library classes use only Php::Exception, so benchmark defines it as
+ * standard runtime error.
+ */
+#include <stdexcept>
+#include <string>
+
+namespace Php {
+  class Exception : public std::runtime_error {
+    public:
+      Exception(const std::string &message) : std::runtime_error(message) {
+      }
+  };
+}
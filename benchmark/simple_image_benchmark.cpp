@@ -0,0 +1,350 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * Simple Image benchmark.
+ *
+ * Measures detection and training hot paths on synthetic images and
+ * cascades, generated from fixed seed, and prints results as JSON.
+ *
+ * Usage: simple_image_benchmark [--threads N] [--seed N] [--quick]
+ */
+
+#include <phpcpp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include "../includes/SimpleImageHelpers.h"
+#include "../includes/IntegralImages.h"
+#include "../includes/HaarFeature.h"
+#include "../includes/WeaklyClassifier.h"
+#include "../includes/ForcefulClassifier.h"
+#include "../includes/CascadeClassifier.h"
+#include "../includes/ThreadPool.h"
+#include "../includes/CompiledCascade.h"
+#include "../includes/ScaledCascade.h"
+#include "../includes/DetectionEngine.h"
+#include "../includes/PyramidDetectionEngine.h"
+#include "../includes/SamplePool.h"
+#include "../includes/ModelLoader.h"
+#include "../includes/AdaBoost.h"
+
+// Benchmark options structure.
+struct benchmark_options {
+  unsigned int threads;
+  unsigned int seed;
+  bool quick;
+};
+
+/**
+ * Get seconds from start time.
+ */
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Generate synthetic gray image with gradient, boxes and noise.
+ */
+static std::vector<float> synthetic_image(int w, int h, std::mt19937 &generator) {
+  std::vector<float> image(w * h);
+  std::uniform_real_distribution<float> noise(-0.1, 0.1);
+  std::uniform_int_distribution<int> box_x(0, w - 1), box_y(0, h - 1), box_size(4, 64);
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      image[y * w + x] = 0.3f + 0.4f * x / w + noise(generator);
+    }
+  }
+  for (int i = 0; i < 200; i++) {
+    int x1 = box_x(generator), y1 = box_y(generator), bw = box_size(generator), bh = box_size(generator);
+    float shade = (i % 2) ? 0.9f : 0.1f;
+    for (int y = y1; y < y1 + bh && y < h; y++) {
+      for (int x = x1; x < x1 + bw && x < w; x++) {
+        image[y * w + x] = shade + noise(generator);
+      }
+    }
+  }
+  return image;
+}
+
+/**
+ * Generate synthetic cascade with random features inside window.
+ */
+static CascadeClassifier* synthetic_cascade(int size, unsigned int stages_count, std::mt19937 &generator) {
+  std::vector<ForcefulClassifier*> forceful_classifiers;
+  std::uniform_int_distribution<int> type_distribution(0, 3), state_distribution(0, 1);
+  std::uniform_real_distribution<float> limit_distribution(-0.5, 0.5), weight_distribution(0.2, 1.0);
+  // Width and height multiples of each feature type.
+  int type_w[4] = {2, 1, 3, 1}, type_h[4] = {1, 2, 1, 3};
+
+  for (unsigned int stage = 0; stage < stages_count; stage++) {
+    std::vector<WeaklyClassifier*> weakly_classifiers;
+    float *weights = new float[3 + 2 * stage];
+    for (unsigned int i = 0; i < 3 + 2 * stage; i++) {
+      int type = type_distribution(generator);
+      int w = type_w[type] * std::uniform_int_distribution<int>(2, size / type_w[type])(generator);
+      int h = type_h[type] * std::uniform_int_distribution<int>(2, size / type_h[type])(generator);
+      int x = std::uniform_int_distribution<int>(0, size - w)(generator);
+      int y = std::uniform_int_distribution<int>(0, size - h)(generator);
+      weakly_classifiers.push_back(new WeaklyClassifier(new HaarFeature(type, x, y, w, h), limit_distribution(generator), state_distribution(generator)));
+      weights[i] = weight_distribution(generator);
+    }
+    // Zero limit passes about half of windows on each stage.
+    forceful_classifiers.push_back(new ForcefulClassifier(weakly_classifiers, weights, 0));
+    delete[] weights;
+  }
+  return new CascadeClassifier(forceful_classifiers, size);
+}
+
+/**
+ * Generate normalized training sample, positive samples have dark center.
+ */
+static void synthetic_sample(int size, bool positive, std::mt19937 &generator, float *sample) {
+  std::uniform_real_distribution<float> noise(0, 1);
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      bool center = x > size / 4 && x < size * 3 / 4 && y > size / 4 && y < size * 3 / 4;
+      sample[y * size + x] = positive && center ? 0.3f * noise(generator) : noise(generator);
+    }
+  }
+  normalize_sample(sample, size, size);
+}
+
+/**
+ * Measure padded integral images computing.
+ */
+static void benchmark_integral_image(benchmark_options &options, std::mt19937 &generator) {
+  int sizes[2][2] = {{640, 480}, {1920, 1080}};
+  unsigned int repeats = options.quick ? 5 : 50;
+
+  printf("  \"integral_image\": [\n");
+  for (int i = 0; i < 2; i++) {
+    int w = sizes[i][0], h = sizes[i][1];
+    std::vector<float> image = synthetic_image(w, h, generator), integral_image((w + 1) * (h + 1));
+    for (int squared = 0; squared < 2; squared++) {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      for (unsigned int k = 0; k < repeats; k++) {
+        compute_padded_integral_image(image.data(), w, h, squared, integral_image.data());
+      }
+      double seconds = seconds_since(start) / repeats;
+      printf("    {\"width\": %d, \"height\": %d, \"kernel\": \"%s\", \"seconds\": %.9f, \"megapixels_per_second\": %.3f},\n",
+        w, h, squared ? "squared" : "plain", seconds, w * h / seconds / 1e6);
+    }
+    // Both tables by fused kernel in one pass.
+    float *fused_integral_image = IntegralImages::allocate(w, h), *fused_squared_integral_image = IntegralImages::allocate(w, h);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned int k = 0; k < repeats; k++) {
+      IntegralImages::compute(image.data(), w, h, fused_integral_image, fused_squared_integral_image);
+    }
+    double seconds = seconds_since(start) / repeats;
+    free(fused_integral_image);
+    free(fused_squared_integral_image);
+    printf("    {\"width\": %d, \"height\": %d, \"kernel\": \"fused\", \"seconds\": %.9f, \"megapixels_per_second\": %.3f}%s\n",
+      w, h, seconds, w * h / seconds / 1e6, i == 1 ? "" : ",");
+  }
+  printf("  ],\n");
+}
+
+/**
+ * Measure multi-scale detection by scaled cascade and by image pyramid.
+ */
+static void benchmark_detection(benchmark_options &options, std::mt19937 &generator, ThreadPool *thread_pool) {
+  int w = 640, h = 480, size = 24;
+  float scale_step = 1.25, slide_step = 0.1;
+  unsigned int repeats = options.quick ? 2 : 10;
+  std::vector<float> image = synthetic_image(w, h, generator);
+  CascadeClassifier *cascade_classifier = synthetic_cascade(size, 20, generator);
+  CompiledCascade compiled_cascade(cascade_classifier);
+  destroy_cascade_classifier(cascade_classifier);
+
+  float *integral_image = IntegralImages::allocate(w, h), *squared_integral_image = IntegralImages::allocate(w, h);
+  IntegralImages::compute(image.data(), w, h, integral_image, squared_integral_image);
+  DetectionEngine detection_engine(&compiled_cascade, w, h, scale_step, slide_step, 1);
+
+  // Windows count over all scales.
+  unsigned long long windows = 0;
+  for (unsigned int k = 0; k < detection_engine.scalesCount(); k++) {
+    int scaled_size = compiled_cascade.scaledSize(k, scale_step), slide = scaled_size * slide_step;
+    if (slide < 1) {
+      slide = 1;
+    }
+    windows += (unsigned long long) ((w - scaled_size) / slide + 1) * ((h - scaled_size) / slide + 1);
+  }
+
+  int detections = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (unsigned int k = 0; k < repeats; k++) {
+    DetectionManager detection_manager;
+    detection_engine.detect(integral_image, squared_integral_image, thread_pool, &detection_manager);
+    detections = detection_manager.count();
+  }
+  double seconds = seconds_since(start) / repeats;
+  free(integral_image);
+  free(squared_integral_image);
+
+  printf("  \"detection\": {\"width\": %d, \"height\": %d, \"size\": %d, \"stages\": %u, \"weakly\": %u, \"scales\": %u, \"windows\": %llu, \"detections\": %d, \"seconds\": %.9f, \"windows_per_second\": %.1f},\n",
+    w, h, size, compiled_cascade.stagesCount(), compiled_cascade.weaklyCount(), detection_engine.scalesCount(), windows, detections, seconds, windows / seconds);
+
+  // The same detection on image pyramid, levels are built on every run.
+  PyramidDetectionEngine pyramid_engine(&compiled_cascade, w, h, scale_step, slide_step, 1);
+  int slide = size * slide_step > 1 ? size * slide_step : 1;
+  windows = 0;
+  for (unsigned int k = 0; k < pyramid_engine.levelsCount(); k++) {
+    int level_w = w / pow(scale_step, k), level_h = h / pow(scale_step, k);
+    windows += (unsigned long long) ((level_w - size) / slide + 1) * ((level_h - size) / slide + 1);
+  }
+  start = std::chrono::steady_clock::now();
+  for (unsigned int k = 0; k < repeats; k++) {
+    DetectionManager detection_manager;
+    pyramid_engine.detect(image.data(), thread_pool, &detection_manager);
+    detections = detection_manager.count();
+  }
+  seconds = seconds_since(start) / repeats;
+
+  printf("  \"pyramid_detection\": {\"width\": %d, \"height\": %d, \"size\": %d, \"levels\": %u, \"windows\": %llu, \"detections\": %d, \"seconds\": %.9f, \"windows_per_second\": %.1f},\n",
+    w, h, size, pyramid_engine.levelsCount(), windows, detections, seconds, windows / seconds);
+}
+
+/**
+ * Measure model loading from text and binary files.
+ */
+static void benchmark_model_load(benchmark_options &options, std::mt19937 &generator) {
+  unsigned int repeats = options.quick ? 5 : 50;
+  char directory[] = "/tmp/simple_image_benchmark_XXXXXX";
+  if (mkdtemp(directory) == NULL) {
+    throw Php::Exception("Simple Image: Benchmark temporary directory can not be created");
+  }
+  std::string text_path = std::string(directory) + "/model.txt", binary_path = std::string(directory) + "/model.bin";
+  CascadeClassifier *cascade_classifier = synthetic_cascade(24, 25, generator);
+  cascade_classifier->save(text_path);
+  CompiledCascade *compiled_cascade = new CompiledCascade(cascade_classifier);
+  compiled_cascade->save(binary_path);
+  unsigned int stages_count = compiled_cascade->stagesCount(), weakly_count = compiled_cascade->weaklyCount();
+  delete compiled_cascade;
+  destroy_cascade_classifier(cascade_classifier);
+
+  double seconds[2];
+  std::string paths[2] = {text_path, binary_path};
+  for (int i = 0; i < 2; i++) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned int k = 0; k < repeats; k++) {
+      delete load_compiled_cascade_from_file(paths[i]);
+    }
+    seconds[i] = seconds_since(start) / repeats;
+  }
+  unlink(text_path.c_str());
+  unlink(binary_path.c_str());
+  rmdir(directory);
+
+  printf("  \"model_load\": {\"stages\": %u, \"weakly\": %u, \"text_seconds\": %.9f, \"binary_seconds\": %.9f},\n",
+    stages_count, weakly_count, seconds[0], seconds[1]);
+}
+
+/**
+ * Measure AdaBoost rounds at several samples sizes for each boosting mode.
+ */
+static void benchmark_ada_boost(benchmark_options &options, std::mt19937 &generator, ThreadPool *thread_pool) {
+  int sizes[2] = {21, 24};
+  boosting_mode modes[3] = {boosting_discrete, boosting_real, boosting_gentle};
+  const char *mode_names[3] = {"discrete", "real", "gentle"};
+  unsigned int samples_count = options.quick ? 100 : 400;
+
+  printf("  \"ada_boost\": [\n");
+  for (int i = 0; i < 2; i++) {
+    int size = sizes[i];
+    std::vector<float> sample(size * size);
+    SamplePool positive_pool(size, samples_count), negative_pool(size, samples_count);
+    for (unsigned int k = 0; k < samples_count; k++) {
+      synthetic_sample(size, true, generator, sample.data());
+      positive_pool.add(sample.data());
+      synthetic_sample(size, false, generator, sample.data());
+      negative_pool.add(sample.data());
+    }
+    std::vector<HaarFeature*> haar_features = create_haar_features(size, size);
+    CascadeClassifier cascade_classifier(size);
+
+    for (int j = 0; j < 3; j++) {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      ForcefulClassifier *forceful_classifier = ada_boost(&cascade_classifier, haar_features, positive_pool.samples(), negative_pool.samples(), 0.5, 0.01, size, modes[j], thread_pool);
+      double seconds = seconds_since(start);
+      unsigned int rounds = forceful_classifier->getWeaklyClassifiers().size();
+
+      printf("    {\"size\": %d, \"mode\": \"%s\", \"features\": %u, \"samples\": %u, \"rounds\": %u, \"seconds\": %.6f, \"seconds_per_round\": %.6f}%s\n",
+        size, mode_names[j], (unsigned int) haar_features.size(), 2 * samples_count, rounds, seconds, rounds > 0 ? seconds / rounds : 0, i == 1 && j == 2 ? "" : ",");
+
+      forceful_classifier->destroyClassifiers();
+      delete forceful_classifier;
+    }
+    for (unsigned int k = 0; k < haar_features.size(); k++) {
+      delete haar_features[k];
+    }
+  }
+  printf("  ]\n");
+}
+
+/**
+ * Parse command line options.
+ */
+static benchmark_options parse_options(int argc, char **argv) {
+  benchmark_options options;
+  options.threads = 0;
+  options.seed = 1;
+  options.quick = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      options.threads = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      options.seed = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--quick") == 0) {
+      options.quick = true;
+    }
+    else {
+      fprintf(stderr, "Usage: %s [--threads N] [--seed N] [--quick]\n", argv[0]);
+      exit(1);
+    }
+  }
+  return options;
+}
+
+int main(int argc, char **argv) {
+  benchmark_options options = parse_options(argc, argv);
+  ThreadPool thread_pool(resolve_threads_count(options.threads));
+  std::mt19937 generator(options.seed);
+
+  try {
+    printf("{\n");
+    printf("  \"threads\": %u,\n", thread_pool.size());
+    printf("  \"seed\": %u,\n", options.seed);
+    benchmark_integral_image(options, generator);
+    benchmark_detection(options, generator, &thread_pool);
+    benchmark_model_load(options, generator);
+    benchmark_ada_boost(options, generator, &thread_pool);
+    printf("}\n");
+  }
+  catch (std::exception &error) {
+    fprintf(stderr, "%s\n", error.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,285 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <phpcpp.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "SimpleImageHelpers.h"
+#include "HaarFeature.h"
+#include "WeaklyClassifier.h"
+#include "ForcefulClassifier.h"
+#include "CascadeClassifier.h"
+#include "ThreadPool.h"
+#include "FeatureResponseStore.h"
+#include "AdaBoost.h"
+
+// Haar features count per one prime weakly classifier search task.
+const unsigned int features_per_task = 256;
+
+// Best weakly classifier search result structure.
+struct weakly_search_result {
+  float error;
+  float limit;
+  bool state;
+  unsigned int feature_index;
+};
+
+/**
+ * Continue soft cascade scores of samples by new weakly classifier votes.
+ *
+ * Scores after the new weakly classifier are added as next row, first row
+ * continues scores carried from previous stages.
+ */
+static void add_soft_scores(WeaklyClassifier *weakly_classifier, float weight, std::vector<float*> &samples, std::vector<float> &carried_scores, std::vector<std::vector<float> > &scores, int size) {
+  scores.push_back(scores.empty() ? carried_scores : scores.back());
+  std::vector<float> &last_scores = scores.back();
+  for (unsigned int i = 0; i < samples.size(); i++) {
+    last_scores[i] += weight * weakly_classifier->classifyImage(samples[i], size + 1, 1, 1, 0, 1);
+  }
+}
+
+/**
+ * AdaBoost algorithm function.
+ *
+ * Discrete AdaBoost selects threshold weakly classifier with minimal
+ * weighted error and votes with its weight. Real and Gentle AdaBoost select
+ * lookup table weakly classifier with minimal score, its bins values are
+ * votes already, so its weight is 1 and samples weights are multiplied by
+ * exp(-label * vote).
+ *
+ * For soft cascade stage scores of samples are carried from previous
+ * stages, limit, rejection limits and FPR are calculated by them after
+ * each weakly classifier, so stage stops, as soon as carried scores reach
+ * target FPR.
+ */
+ForcefulClassifier* ada_boost(CascadeClassifier *cascade_classifier, std::vector<HaarFeature*> &haar_features, std::vector<float*> &positive_samples, std::vector<float*> &negative_samples, float fpr, float fnr, int size, boosting_mode mode, ThreadPool *thread_pool) {
+  WeaklyClassifier *prime_weakly_classifier;
+  ForcefulClassifier *forceful_classifier = new ForcefulClassifier();
+  unsigned int positive_size = positive_samples.size(), negative_size = negative_samples.size(), sizes_sum = positive_size + negative_size;
+  unsigned int features_count = haar_features.size(), tasks_count = (features_count + features_per_task - 1) / features_per_task, prime_result;
+  float weights_sum, positive_weights_sum, negative_weights_sum, minimal_error, classifier_fpr = 1.0, temp, weight;
+  std::vector<weakly_search_result> search_results(tasks_count);
+  float *weights = new float[sizes_sum];
+  // Soft cascade scores carried from previous stages and scores after each
+  // weakly classifier of stage.
+  bool soft = cascade_classifier->isSoft();
+  std::vector<float> positive_carried_scores, negative_carried_scores;
+  std::vector<std::vector<float> > positive_scores, negative_scores;
+  if (soft) {
+    positive_carried_scores = cascade_classifier->calculateScores(positive_samples);
+    negative_carried_scores = cascade_classifier->calculateScores(negative_samples);
+  }
+
+  // Feature values do not depend on weights, so compute and sort them once per step.
+  FeatureResponseStore feature_store(haar_features, positive_samples, negative_samples, size, thread_pool);
+
+  for (unsigned int i = 0; i < positive_size; i++) {
+    weights[i] = 1 / float(2 * positive_size);
+  }
+  for (unsigned int i = 0; i < negative_size; i++) {
+    weights[positive_size + i] = 1 / float(2 * negative_size);
+  }
+
+  while (classifier_fpr > fpr) {
+    // Stop adding new weakly classifiers after all negative samples are correctly classified.
+    // Soft cascade negative samples pass previous stages, so empty stage is not checked.
+    if (!soft && forceful_classifier->calculateFpr(negative_samples, size) == 0) {
+      break;
+    }
+
+    // Normalize weights for current i.
+    weights_sum = 0;
+    for (unsigned int i = 0; i < sizes_sum; i++) {
+      weights_sum += weights[i];
+    }
+    positive_weights_sum = negative_weights_sum = 0;
+    for (unsigned int i = 0; i < sizes_sum; i++) {
+      weights[i] = weights[i] / weights_sum;
+      if (i < positive_size) {
+        positive_weights_sum += weights[i];
+      }
+      else {
+        negative_weights_sum += weights[i];
+      }
+    }
+
+    // Select prime weakly classifier.
+    // Each task searches fixed features range, so the reduction below
+    // gives the same result for any threads count.
+    thread_pool->run(tasks_count, [&](unsigned int worker_index, unsigned int task_index) {
+      unsigned int first_feature = task_index * features_per_task, last_feature = std::min(first_feature + features_per_task, features_count);
+      weakly_search_result &result = search_results[task_index];
+      float error;
+      result.error = 1;
+      result.feature_index = features_count;
+      for (unsigned int feature_index = first_feature; feature_index < last_feature; feature_index++) {
+        WeaklyClassifier weakly_classifier(haar_features[feature_index]);
+        if (mode == boosting_discrete) {
+          error = weakly_classifier.calculateLimit(feature_store.sortedValues(feature_index), feature_store.sortedIndexes(feature_index), positive_size, sizes_sum, weights, positive_weights_sum, negative_weights_sum);
+        }
+        else {
+          error = weakly_classifier.calculateTable(feature_store.sortedValues(feature_index), feature_store.sortedIndexes(feature_index), positive_size, sizes_sum, weights, mode == boosting_gentle);
+        }
+        if (error < result.error) {
+          result.error = error;
+          result.limit = weakly_classifier.getLimit();
+          result.state = weakly_classifier.getState();
+          result.feature_index = feature_index;
+        }
+      }
+    });
+    minimal_error = 1;
+    prime_result = tasks_count;
+    for (unsigned int i = 0; i < tasks_count; i++) {
+      if (search_results[i].error < minimal_error) {
+        prime_result = i;
+        minimal_error = search_results[i].error;
+      }
+    }
+    // No weakly classifier splits samples better than random one.
+    if (prime_result == tasks_count) {
+      break;
+    }
+
+    if (mode == boosting_discrete) {
+      prime_weakly_classifier = new WeaklyClassifier(haar_features[search_results[prime_result].feature_index], search_results[prime_result].limit, search_results[prime_result].state);
+
+      // Update weights array.
+      temp = minimal_error / (1 - minimal_error);
+      for (unsigned int i = 0; i < positive_size; i++) {
+        if (prime_weakly_classifier->classifyImage(positive_samples[i], size + 1, 1, 1, 0, 1) == 1) {
+          weights[i] = weights[i] * temp;
+        }
+      }
+      for (unsigned int i = 0; i < negative_size; i++) {
+        if (prime_weakly_classifier->classifyImage(negative_samples[i], size + 1, 1, 1, 0, 1) == -1) {
+          weights[positive_size + i] = weights[positive_size + i] * temp;
+        }
+      }
+      weight = log(1 / temp);
+    }
+    else {
+      // Lookup table is calculated again only for selected feature.
+      prime_weakly_classifier = new WeaklyClassifier(haar_features[search_results[prime_result].feature_index]);
+      prime_weakly_classifier->calculateTable(feature_store.sortedValues(search_results[prime_result].feature_index), feature_store.sortedIndexes(search_results[prime_result].feature_index), positive_size, sizes_sum, weights, mode == boosting_gentle);
+
+      // Update weights array.
+      for (unsigned int i = 0; i < positive_size; i++) {
+        weights[i] = weights[i] * exp(-prime_weakly_classifier->classifyImage(positive_samples[i], size + 1, 1, 1, 0, 1));
+      }
+      for (unsigned int i = 0; i < negative_size; i++) {
+        weights[positive_size + i] = weights[positive_size + i] * exp(prime_weakly_classifier->classifyImage(negative_samples[i], size + 1, 1, 1, 0, 1));
+      }
+      weight = 1;
+    }
+    forceful_classifier->addClassifier(prime_weakly_classifier, weight);
+
+    // Update current FPR.
+    if (soft) {
+      add_soft_scores(prime_weakly_classifier, weight, positive_samples, positive_carried_scores, positive_scores, size);
+      add_soft_scores(prime_weakly_classifier, weight, negative_samples, negative_carried_scores, negative_scores, size);
+      forceful_classifier->calculateRejections(positive_scores, fnr);
+      classifier_fpr = forceful_classifier->calculateFpr(negative_scores);
+    }
+    else {
+      forceful_classifier->calculateLimit(positive_samples, size, fnr);
+      classifier_fpr = forceful_classifier->calculateFpr(negative_samples, size);
+    }
+  }
+  delete[] weights;
+
+  return forceful_classifier;
+}
+
+/**
+ * Get boosting mode by name.
+ */
+boosting_mode boosting_mode_from_string(std::string name) {
+  if (name == "discrete") {
+    return boosting_discrete;
+  }
+  if (name == "real") {
+    return boosting_real;
+  }
+  if (name == "gentle") {
+    return boosting_gentle;
+  }
+  throw Php::Exception("Simple Image: Boosting mode must be discrete, real or gentle");
+}
+
+/**
+ * Create Haar features set by samples sizes.
+ */
+std::vector<HaarFeature*> create_haar_features(int w, int h) {
+  std::vector<HaarFeature*> result;
+  HaarFeature *feature;
+  int x, y, feature_min_w, feature_w, feature_h;
+
+  // We have 4 features types.
+  for (int feature_type = 0; feature_type < 4; feature_type++) {
+    x = y = 0;
+    if (feature_type != 2) {
+      feature_min_w = feature_w = 4;
+    }
+    else {
+      feature_min_w = feature_w = 3;
+    }
+    if (feature_type != 3) {
+      feature_h = 4;
+    }
+    else {
+      feature_h = 3;
+    }
+    while (feature_h <= h) {
+      while (feature_w <= w) {
+        while (y + feature_h <= h) {
+          while (x + feature_w <= w) {
+            feature = new HaarFeature(feature_type, x, y, feature_w, feature_h);
+            result.push_back(feature);
+            x++;
+          }
+          x = 0;
+          y++;
+        }
+        y = 0;
+        switch (feature_type) {
+          case 0:
+            feature_w += 2;
+            break;
+          case 2:
+            feature_w += 3;
+            break;
+          default:
+            feature_w++;
+        }
+      }
+      feature_w = feature_min_w;
+      switch (feature_type) {
+        case 1:
+          feature_h += 2;
+          break;
+        case 3:
+          feature_h += 3;
+          break;
+        default:
+          feature_h++;
+      }
+    }
+  }
+  return result;
+}
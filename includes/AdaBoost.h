@@ -0,0 +1,30 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Boosting modes, discrete AdaBoost learns threshold weakly classifiers,
+// Real and Gentle AdaBoost learn lookup table weakly classifiers.
+enum boosting_mode {
+  boosting_discrete,
+  boosting_real,
+  boosting_gentle
+};
+
+// AdaBoost algorithm function.
+ForcefulClassifier* ada_boost(CascadeClassifier *cascade_classifier, std::vector<HaarFeature*> &haar_features, std::vector<float*> &positive_samples, std::vector<float*> &negative_samples, float fpr, float fnr, int size, boosting_mode mode, ThreadPool *thread_pool);
+// Get boosting mode by name.
+boosting_mode boosting_mode_from_string(std::string name);
+// Create Haar features set by samples sizes.
+std::vector<HaarFeature*> create_haar_features(int w, int h);
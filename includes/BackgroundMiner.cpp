@@ -0,0 +1,239 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <phpcpp.h>
+#include <Magick++.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <string>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include "SimpleImageHelpers.h"
+#include "HaarFeature.h"
+#include "WeaklyClassifier.h"
+#include "ForcefulClassifier.h"
+#include "CascadeClassifier.h"
+#include "CompiledCascade.h"
+#include "ScaledCascade.h"
+#include "ThreadPool.h"
+#include "IntegralImages.h"
+#include "DetectionEngine.h"
+#include "SamplePool.h"
+#include "BackgroundMiner.h"
+
+// Approximate windows count per background detection task.
+const unsigned int background_windows_per_task = 4096;
+
+/**
+ * BackgroundMiner constructor.
+ */
+BackgroundMiner::BackgroundMiner(std::vector<std::string> files, int size, bool normalize, bool rotation, ThreadPool *thread_pool) {
+  this->files = files;
+  this->size = size;
+  this->normalize = normalize;
+  this->rotation = rotation;
+  this->slide = size * background_slide_step;
+  if (this->slide < 1) {
+    this->slide = 1;
+  }
+  this->thread_pool = thread_pool;
+  this->visit = 0;
+}
+
+/**
+ * Fill pool by windows, which pass cascade, up to count.
+ *
+ * Mining is stopped before pool is full, when every image was visited
+ * once without new samples.
+ */
+void BackgroundMiner::mine(CascadeClassifier *cascade_classifier, SamplePool &pool, unsigned int count) {
+  if (pool.size() >= count || this->files.empty()) {
+    return;
+  }
+  CompiledCascade compiled_cascade(cascade_classifier);
+  unsigned int empty_visits = 0;
+  while (pool.size() < count && empty_visits < this->files.size()) {
+    if (this->mineImage(cascade_classifier, &compiled_cascade, pool, count) > 0) {
+      empty_visits = 0;
+    }
+    else {
+      empty_visits++;
+    }
+  }
+}
+
+/**
+ * Get mining position, it can be restored by seek.
+ */
+unsigned long long BackgroundMiner::position() {
+  return this->visit;
+}
+
+/**
+ * Continue mining from position.
+ */
+void BackgroundMiner::seek(unsigned long long position) {
+  this->visit = position;
+}
+
+/**
+ * Put windows of one image visit, which pass cascade, in pool.
+ *
+ * Windows are found by scaled cascade on levels integral images, as in
+ * pyramid detection, and then cut from level pixels, normalized and
+ * rotated, if needed, and classified by training cascade, so pool gets
+ * only true training samples. Get added samples count.
+ */
+unsigned int BackgroundMiner::mineImage(CascadeClassifier *cascade_classifier, CompiledCascade *compiled_cascade, SamplePool &pool, unsigned int count) {
+  std::mt19937 generator(this->visit);
+  const std::string &file = this->files[this->visit % this->files.size()];
+  this->visit++;
+
+  Magick::Image image;
+  try {
+    image.read(file);
+  }
+  catch (std::exception &error) {
+    throw Php::Exception("Simple Image: Background image can not be read");
+  }
+  image.type(Magick::GrayscaleType);
+  unsigned int columns = image.columns(), rows = image.rows();
+  std::vector<float> pixels(columns * rows);
+  image_pixels_shade(image, pixels.data());
+
+  // Levels start from random scale and have random windows offsets.
+  std::uniform_real_distribution<float> scale_distribution(0, 1);
+  std::uniform_int_distribution<unsigned int> offset_distribution(0, this->slide - 1);
+  float first_scale = pow(background_scale_step, scale_distribution(generator));
+  std::vector<background_level> levels;
+  background_level level;
+  for (unsigned int i = 0; ; i++) {
+    level.scale = first_scale * pow(background_scale_step, i);
+    level.columns = columns / level.scale;
+    level.rows = rows / level.scale;
+    if (level.columns < (unsigned int) this->size || level.rows < (unsigned int) this->size) {
+      break;
+    }
+    level.x = offset_distribution(generator);
+    level.y = offset_distribution(generator);
+    if (level.columns - level.x < (unsigned int) this->size) {
+      level.x = 0;
+    }
+    if (level.rows - level.y < (unsigned int) this->size) {
+      level.y = 0;
+    }
+    level.integral_image = NULL;
+    level.squared_integral_image = NULL;
+    level.scaled_cascade = NULL;
+    levels.push_back(level);
+  }
+  if (levels.empty()) {
+    return 0;
+  }
+  this->thread_pool->run(levels.size(), [&](unsigned int worker_index, unsigned int level_index) {
+    background_level &level = levels[level_index];
+    level.pixels.resize(level.columns * level.rows);
+    downsample_pixels(pixels.data(), columns, rows, level.scale, level.pixels.data(), level.columns, level.rows);
+    level.integral_image = IntegralImages::allocate(level.columns, level.rows);
+    level.squared_integral_image = IntegralImages::allocate(level.columns, level.rows);
+    IntegralImages::compute(level.pixels.data(), level.columns, level.rows, level.integral_image, level.squared_integral_image);
+    level.scaled_cascade = new ScaledCascade(compiled_cascade, 0, background_scale_step, 1, level.columns + 1);
+  });
+
+  // Split windows rows of each level in bands of similar windows count.
+  std::vector<detection_task> tasks;
+  detection_task task;
+  unsigned int windows_columns, windows_rows, band_rows;
+  for (unsigned int i = 0; i < levels.size(); i++) {
+    windows_columns = (levels[i].columns - levels[i].x - this->size) / this->slide + 1;
+    windows_rows = (levels[i].rows - levels[i].y - this->size) / this->slide + 1;
+    band_rows = background_windows_per_task / windows_columns;
+    if (band_rows < 1) {
+      band_rows = 1;
+    }
+    task.scale_index = i;
+    for (unsigned int row = 0; row < windows_rows; row += band_rows) {
+      task.first_row = row;
+      task.last_row = row + band_rows < windows_rows ? row + band_rows : windows_rows;
+      tasks.push_back(task);
+    }
+  }
+  std::vector<std::vector<detection_structure> > detections(tasks.size());
+  this->thread_pool->run(tasks.size(), [&](unsigned int worker_index, unsigned int task_index) {
+    background_level &level = levels[tasks[task_index].scale_index];
+    unsigned int offset = level.y * (level.columns + 1) + level.x;
+    detect_windows_rows(level.scaled_cascade, level.integral_image + offset, level.squared_integral_image + offset, level.columns - level.x, this->slide, tasks[task_index].first_row, tasks[task_index].last_row, detections[task_index]);
+    for (unsigned int i = 0; i < detections[task_index].size(); i++) {
+      detections[task_index][i].x += level.x;
+      detections[task_index][i].y += level.y;
+      // Keep level index in size, windows size is the samples size.
+      detections[task_index][i].size = tasks[task_index].scale_index;
+    }
+  });
+  for (unsigned int i = 0; i < levels.size(); i++) {
+    free(levels[i].integral_image);
+    free(levels[i].squared_integral_image);
+    delete levels[i].scaled_cascade;
+  }
+
+  // Merge windows in tasks order, so result does not depend on threads.
+  std::vector<detection_structure> windows;
+  for (unsigned int i = 0; i < detections.size(); i++) {
+    windows.insert(windows.end(), detections[i].begin(), detections[i].end());
+  }
+  detections.clear();
+
+  // Take random windows one by one, until enough samples are added.
+  unsigned int added = 0, limit = count - pool.size();
+  if (limit > background_samples_per_visit) {
+    limit = background_samples_per_visit;
+  }
+  // Rotated windows go after window, as rotated samples of samples file.
+  std::vector<float> sample(this->size * this->size);
+  float *rotated_sample;
+  int rotations_count = this->rotation ? 4 : 1;
+  for (unsigned int i = 0; i < windows.size() && added < limit; i++) {
+    std::uniform_int_distribution<unsigned int> window_distribution(i, windows.size() - 1);
+    std::swap(windows[i], windows[window_distribution(generator)]);
+    background_level &level = levels[windows[i].size];
+    for (int y = 0; y < this->size; y++) {
+      memcpy(sample.data() + y * this->size, level.pixels.data() + (windows[i].y + y) * level.columns + windows[i].x, this->size * sizeof(float));
+    }
+    if (this->normalize) {
+      normalize_sample(sample.data(), this->size, this->size);
+    }
+    for (int rotation_index = 0; rotation_index < rotations_count && added < limit; rotation_index++) {
+      if (cascade_classifier->classifyImage(pool.add(sample.data()), this->size + 1, 1, 1, 0, 1)) {
+        added++;
+      }
+      else {
+        pool.removeLast();
+      }
+      if (rotation_index < rotations_count - 1) {
+        rotated_sample = sample_rotate_90(sample.data(), this->size, this->size);
+        memcpy(sample.data(), rotated_sample, this->size * this->size * sizeof(float));
+        delete[] rotated_sample;
+      }
+    }
+  }
+  return added;
+}
@@ -0,0 +1,77 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <vector>
+#include <string>
+#include <random>
+
+// Default pyramid scale step and windows slide step of background mining.
+const float background_scale_step = 1.25;
+const float background_slide_step = 0.25;
+// Maximum samples taken from one image visit.
+const unsigned int background_samples_per_visit = 64;
+
+// Background image level structure.
+struct background_level {
+  // Level scale relative to image, level sizes and windows offset.
+  float scale;
+  unsigned int columns;
+  unsigned int rows;
+  unsigned int x;
+  unsigned int y;
+  // Level pixels shade and integral images with zero first row and column.
+  std::vector<float> pixels;
+  float *integral_image;
+  float *squared_integral_image;
+  ScaledCascade *scaled_cascade;
+};
+
+/**
+ * Hard negative samples miner of background images.
+ *
+ * Images are visited in turn. On every visit the image is downsampled by
+ * scale step, starting from random scale, and the current cascade slides
+ * over every level from random offset, so the next visits of image give
+ * other windows. Windows, which pass the cascade, are checked again as
+ * training samples, normalized and rotated, if needed, as samples file
+ * negatives, and a random part of them is put in pool.
+ * Every visit has own random generator seeded by visit number, so mining
+ * can be continued from position as samples file reading.
+ */
+class BackgroundMiner {
+  public:
+    // Background miner constructor.
+    BackgroundMiner(std::vector<std::string> files, int size, bool normalize, bool rotation, ThreadPool *thread_pool);
+    // Fill pool by windows, which pass cascade, up to count.
+    void mine(CascadeClassifier *cascade_classifier, SamplePool &pool, unsigned int count);
+    // Get mining position, it can be restored by seek.
+    unsigned long long position();
+    // Continue mining from position.
+    void seek(unsigned long long position);
+  protected:
+    // Background images files.
+    std::vector<std::string> files;
+    // Samples size and windows slide.
+    int size;
+    unsigned int slide;
+    // Samples normalization and rotation flags.
+    bool normalize, rotation;
+    ThreadPool *thread_pool;
+    // Number of the next image visit.
+    unsigned long long visit;
+    // Put windows of one image visit, which pass cascade, in pool.
+    unsigned int mineImage(CascadeClassifier *cascade_classifier, CompiledCascade *compiled_cascade, SamplePool &pool, unsigned int count);
+};
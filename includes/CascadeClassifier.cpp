@@ -21,12 +21,15 @@ limitations under the License.
 #include "WeaklyClassifier.h"
 #include "ForcefulClassifier.h"
 #include "CascadeClassifier.h"
+#include "CompiledCascade.h"
+#include "ScaledCascade.h"
 
 /**
  * CascadeClassifier simple constructor.
  */
 CascadeClassifier::CascadeClassifier(int size) {
   this->size = size;
+  this->soft = false;
 }
 
 /**
@@ -35,6 +38,32 @@ CascadeClassifier::CascadeClassifier(int size) {
 CascadeClassifier::CascadeClassifier(std::vector<ForcefulClassifier*> forceful_classifiers, int size) {
   this->forceful_classifiers = forceful_classifiers;
   this->size = size;
+  this->soft = false;
+}
+
+/**
+ * Create deep classifier copy.
+ */
+CascadeClassifier* CascadeClassifier::copy() {
+  CascadeClassifier *result = new CascadeClassifier(this->size);
+  result->soft = this->soft;
+  std::vector<ForcefulClassifier*>::iterator iterator;
+  for (iterator = this->forceful_classifiers.begin(); iterator != this->forceful_classifiers.end(); iterator++) {
+    result->addClassifier((*iterator)->copy());
+  }
+  return result;
+}
+
+/**
+ * Remove forceful classifiers and their weakly classifiers from memory.
+ */
+void CascadeClassifier::destroyClassifiers() {
+  std::vector<ForcefulClassifier*>::iterator iterator;
+  for (iterator = this->forceful_classifiers.begin(); iterator != this->forceful_classifiers.end(); iterator++) {
+    (*iterator)->destroyClassifiers();
+    delete *iterator;
+  }
+  this->forceful_classifiers.clear();
 }
 
 /**
@@ -44,6 +73,27 @@ int CascadeClassifier::getSize() {
   return this->size;
 }
 
+/**
+ * Get forceful classifiers set.
+ */
+std::vector<ForcefulClassifier*> CascadeClassifier::getForcefulClassifiers() {
+  return this->forceful_classifiers;
+}
+
+/**
+ * Check, that classifier is soft cascade.
+ */
+bool CascadeClassifier::isSoft() {
+  return this->soft;
+}
+
+/**
+ * Set soft cascade flag.
+ */
+void CascadeClassifier::setSoft(bool soft) {
+  this->soft = soft;
+}
+
 /**
  * Scale each forceful classifier and size in set by value.
  */
@@ -73,17 +123,36 @@ void CascadeClassifier::addClassifier(ForcefulClassifier *forceful_classifier) {
 }
 
 /**
- * Calculate classifier FPR.
+ * Calculate soft cascade scores of samples carried over all stages.
+ *
+ * Samples must be integral images with zero first row and column, scores
+ * are summed vote by vote, as by classification.
  */
-float CascadeClassifier::calculateFpr(std::vector<float*> &negative_samples) {
-  unsigned int negative_size = negative_samples.size();
-  int classify_image_count = 0;
-  for (unsigned int i = 0; i < negative_size; i++) {
-    if (this->classifyImage(negative_samples[i], this->size, 0, 0, 0, 1)) {
-      classify_image_count++;
+std::vector<float> CascadeClassifier::calculateScores(std::vector<float*> &samples) {
+  std::vector<float> scores(samples.size(), 0), weights;
+  std::vector<WeaklyClassifier*> weakly_classifiers;
+  for (unsigned int j = 0; j < this->forceful_classifiers.size(); j++) {
+    weakly_classifiers = this->forceful_classifiers[j]->getWeaklyClassifiers();
+    weights = this->forceful_classifiers[j]->getWeights();
+    for (unsigned int i = 0; i < samples.size(); i++) {
+      for (unsigned int k = 0; k < weakly_classifiers.size(); k++) {
+        scores[i] += weights[k] * weakly_classifiers[k]->classifyImage(samples[i], this->size + 1, 1, 1, 0, 1);
+      }
     }
   }
-  return float(classify_image_count) / float(negative_size);
+  return scores;
+}
+
+/**
+ * Calculate classifier FPR.
+ *
+ * Negative samples must be integral images with zero first row and column,
+ * they are classified by batches, as detection windows.
+ */
+float CascadeClassifier::calculateFpr(std::vector<float*> &negative_samples) {
+  CompiledCascade compiled_cascade(this);
+  ScaledCascade scaled_cascade(&compiled_cascade, 0, 1, 1, this->size + 1);
+  return float(scaled_cascade.countAccepted(negative_samples)) / float(negative_samples.size());
 }
 
 /**
@@ -91,6 +160,15 @@ float CascadeClassifier::calculateFpr(std::vector<float*> &negative_samples) {
  */
 bool CascadeClassifier::classifyImage(float *image, int image_width, int x, int y, float temp1, float temp2) {
   std::vector<ForcefulClassifier*>::iterator iterator;
+  if (this->soft) {
+    float score = 0;
+    for (iterator = this->forceful_classifiers.begin(); iterator != this->forceful_classifiers.end(); iterator++) {
+      if (!(*iterator)->classifyImage(image, image_width, x, y, temp1, temp2, score)) {
+        return false;
+      }
+    }
+    return true;
+  }
   for (iterator = this->forceful_classifiers.begin(); iterator != this->forceful_classifiers.end(); iterator++) {
     if (!(*iterator)->classifyImage(image, image_width, x, y, temp1, temp2)) {
       return false;
@@ -104,7 +182,9 @@ bool CascadeClassifier::classifyImage(float *image, int image_width, int x, int
  */
 std::string CascadeClassifier::toString() {
   std::vector<ForcefulClassifier*>::iterator iterator;
-  std::string result = std::to_string(this->size) + " " + std::to_string(this->forceful_classifiers.size()) + "\n";
+  std::string result = std::to_string(this->size) + " " + std::to_string(this->forceful_classifiers.size());
+  // Soft cascade flag is the third header value, weakly classifiers lines end with rejection limits.
+  result += this->soft ? " 1\n" : "\n";
   for (iterator = this->forceful_classifiers.begin(); iterator != this->forceful_classifiers.end(); iterator++) {
     result += (*iterator)->toString();
   }
@@ -119,9 +199,32 @@ bool CascadeClassifier::save(std::string path) {
     std::ofstream file(path);
     file << this->toString();
     file.close();
-    return true;
+    return !file.fail();
   }
-  catch (std::exception e) {
+  catch (const std::exception &e) {
     return false;
   }
 }
+
+/**
+ * Reset statistics for stages count.
+ */
+void reset_cascade_stats(cascade_stats &stats, unsigned int stages_count) {
+  stats.windows = 0;
+  stats.weakly_evaluated = 0;
+  stats.stage_passed.assign(stages_count, 0);
+}
+
+/**
+ * Add statistics to other statistics of the same cascade.
+ */
+void merge_cascade_stats(cascade_stats &target, const cascade_stats &source) {
+  if (target.stage_passed.size() < source.stage_passed.size()) {
+    target.stage_passed.resize(source.stage_passed.size(), 0);
+  }
+  target.windows += source.windows;
+  target.weakly_evaluated += source.weakly_evaluated;
+  for (unsigned int i = 0; i < source.stage_passed.size(); i++) {
+    target.stage_passed[i] += source.stage_passed[i];
+  }
+}
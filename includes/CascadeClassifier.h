@@ -14,22 +14,46 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+// Cascade classification statistics structure.
+struct cascade_stats {
+  // Classified windows count.
+  unsigned long long windows;
+  // Evaluated weakly classifiers count.
+  unsigned long long weakly_evaluated;
+  // Windows count, that passed each stage.
+  std::vector<unsigned long long> stage_passed;
+};
+
 /**
  * Cascade classifier class.
+ *
+ * Soft cascade carries score over stages, see ForcefulClassifier.
  */
 class CascadeClassifier {
   public:
     // Cascade classifier constructors.
     CascadeClassifier(int size);
     CascadeClassifier(std::vector<ForcefulClassifier*> forceful_classifiers, int size);
+    // Create deep classifier copy.
+    CascadeClassifier* copy();
+    // Remove forceful classifiers and their weakly classifiers from memory.
+    void destroyClassifiers();
     // Get classifier size property.
     int getSize();
+    // Get forceful classifiers set.
+    std::vector<ForcefulClassifier*> getForcefulClassifiers();
+    // Check, that classifier is soft cascade.
+    bool isSoft();
+    // Set soft cascade flag.
+    void setSoft(bool soft);
     // Scale forceful classifiers limit by value.
     void scaleByValue(float value);
     // Scale forceful classifiers limit by value.
     void scaleClassifiersLimitByValue(float value);
     // Put new forceful classifier in set.
     void addClassifier(ForcefulClassifier *forceful_classifier);
+    // Calculate soft cascade scores of samples carried over all stages.
+    std::vector<float> calculateScores(std::vector<float*> &samples);
     // Calculate classifier FPR.
     float calculateFpr(std::vector<float*> &negative_samples);
     // Classify image by classifier.
@@ -41,6 +65,13 @@ class CascadeClassifier {
   protected:
     // Classifier basis variable.
     int size;
+    // Soft cascade flag.
+    bool soft;
     // Forceful classifiers set.
     std::vector<ForcefulClassifier*> forceful_classifiers;
 };
+
+// Reset statistics for stages count.
+void reset_cascade_stats(cascade_stats &stats, unsigned int stages_count);
+// Add statistics to other statistics of the same cascade.
+void merge_cascade_stats(cascade_stats &target, const cascade_stats &source);
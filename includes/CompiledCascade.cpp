@@ -0,0 +1,354 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <phpcpp.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+#include <limits>
+#include <fstream>
+#include "SimpleImageHelpers.h"
+#include "HaarFeature.h"
+#include "WeaklyClassifier.h"
+#include "ForcefulClassifier.h"
+#include "CascadeClassifier.h"
+#include "CompiledCascade.h"
+
+/**
+ * CompiledCascade constructor.
+ */
+CompiledCascade::CompiledCascade(CascadeClassifier *cascade_classifier) : CompiledCascade(cascade_classifier->getForcefulClassifiers(), cascade_classifier->getSize()) {
+  this->soft = cascade_classifier->isSoft();
+}
+
+/**
+ * CompiledCascade constructor for forceful classifiers set.
+ */
+CompiledCascade::CompiledCascade(std::vector<ForcefulClassifier*> forceful_classifiers, int size) {
+  std::vector<WeaklyClassifier*> weakly_classifiers;
+  std::vector<float> weights, table, rejections;
+  HaarFeature *feature;
+  unsigned int weakly_index = 0, table_index = 0;
+
+  this->size = size;
+  this->soft = false;
+  this->mapped = NULL;
+  this->mapped_size = 0;
+  this->stages_count = forceful_classifiers.size();
+  this->weakly_count = 0;
+  this->table_count = 0;
+  for (unsigned int i = 0; i < this->stages_count; i++) {
+    weakly_classifiers = forceful_classifiers[i]->getWeaklyClassifiers();
+    this->weakly_count += weakly_classifiers.size();
+    for (unsigned int j = 0; j < weakly_classifiers.size(); j++) {
+      this->table_count += weakly_classifiers[j]->getTable().size();
+    }
+  }
+  this->block = new char[CompiledCascade::blockSize(this->stages_count, this->weakly_count, this->table_count)];
+  CompiledCascade::layout(this->stages_count, this->weakly_count, this->table_count, this->block, this->arrays);
+
+  for (unsigned int i = 0; i < this->stages_count; i++) {
+    weakly_classifiers = forceful_classifiers[i]->getWeaklyClassifiers();
+    weights = forceful_classifiers[i]->getWeights();
+    rejections = forceful_classifiers[i]->getRejections();
+    this->arrays.stage_first[i] = weakly_index;
+    this->arrays.stage_limit[i] = forceful_classifiers[i]->getLimit();
+    for (unsigned int j = 0; j < weakly_classifiers.size(); j++) {
+      feature = weakly_classifiers[j]->getFeature();
+      table = weakly_classifiers[j]->getTable();
+      this->arrays.feature_type[weakly_index] = feature->type();
+      this->arrays.feature_x[weakly_index] = feature->left();
+      this->arrays.feature_y[weakly_index] = feature->top();
+      this->arrays.feature_w[weakly_index] = feature->width();
+      this->arrays.feature_h[weakly_index] = feature->height();
+      this->arrays.weakly_limit[weakly_index] = weakly_classifiers[j]->getLimit();
+      this->arrays.weakly_weight[weakly_index] = weights[j];
+      this->arrays.weakly_state[weakly_index] = weakly_classifiers[j]->getState();
+      this->arrays.table_bins[weakly_index] = table.size();
+      this->arrays.table_bin_width[weakly_index] = weakly_classifiers[j]->getBinWidth();
+      this->arrays.table_first[weakly_index] = table_index;
+      // Weakly classifiers without rejection limits never reject.
+      this->arrays.weakly_rejection[weakly_index] = j < rejections.size() ? rejections[j] : std::numeric_limits<float>::lowest();
+      for (unsigned int k = 0; k < table.size(); k++) {
+        this->arrays.table_values[table_index++] = table[k];
+      }
+      weakly_index++;
+    }
+  }
+  this->arrays.stage_first[this->stages_count] = weakly_index;
+}
+
+/**
+ * CompiledCascade constructor for binary model file.
+ */
+CompiledCascade::CompiledCascade(std::string path) {
+  int file = open(path.c_str(), O_RDONLY);
+  if (file == -1) {
+    throw Php::Exception("Simple Image: Classifier file not exist");
+  }
+  struct stat file_stat;
+  if (fstat(file, &file_stat) != 0 || (size_t) file_stat.st_size < offsetof(compiled_cascade_header, flags)) {
+    close(file);
+    throw Php::Exception("Simple Image: Wrong classifier format");
+  }
+  this->mapped_size = file_stat.st_size;
+  this->mapped = mmap(NULL, this->mapped_size, PROT_READ, MAP_PRIVATE, file, 0);
+  close(file);
+  if (this->mapped == MAP_FAILED) {
+    throw Php::Exception("Simple Image: Classifier file can not be mapped in memory");
+  }
+
+  compiled_cascade_header *header = (compiled_cascade_header*) this->mapped;
+  size_t header_size = header->version < 3 ? offsetof(compiled_cascade_header, flags) : sizeof(compiled_cascade_header);
+  if (this->mapped_size < header_size) {
+    munmap(this->mapped, this->mapped_size);
+    throw Php::Exception("Simple Image: Wrong classifier format");
+  }
+  this->size = header->size;
+  this->stages_count = header->stages_count;
+  this->weakly_count = header->weakly_count;
+  this->table_count = header->version == 1 ? 0 : header->table_count;
+  this->soft = header->version < 3 ? false : (header->flags & compiled_cascade_soft) != 0;
+  this->block = (char*) this->mapped + header_size;
+  // Old versions blocks are the same blocks without last arrays, version 1
+  // has no lookup tables arrays and versions 1 and 2 have no rejection limits.
+  size_t block_size = CompiledCascade::blockSize(this->stages_count, this->weakly_count, this->table_count);
+  if (header->version < 3) {
+    block_size -= (size_t) this->weakly_count * 4;
+  }
+  if (header->version == 1) {
+    block_size -= (size_t) 3 * this->weakly_count * 4;
+  }
+  if (memcmp(header->magic, "SIMGCASC", 8) != 0 || header->version == 0 || header->version > compiled_cascade_version
+      || (header->version >= 3 && ((header->flags & ~compiled_cascade_soft) != 0 || header->reserved != 0))
+      || header->block_size != block_size
+      || header->block_size != this->mapped_size - header_size
+      || header->checksum != CompiledCascade::checksum(this->block, header->block_size)) {
+    munmap(this->mapped, this->mapped_size);
+    throw Php::Exception("Simple Image: Wrong classifier format");
+  }
+  if (header->version < 3) {
+    // Copy old block in memory, missing arrays are zero, as for usual
+    // cascade of threshold weakly classifiers.
+    block_size = CompiledCascade::blockSize(this->stages_count, this->weakly_count, this->table_count);
+    this->block = new char[block_size];
+    memset(this->block, 0, block_size);
+    memcpy(this->block, (char*) this->mapped + header_size, header->block_size);
+    munmap(this->mapped, this->mapped_size);
+    this->mapped = NULL;
+    this->mapped_size = 0;
+  }
+  CompiledCascade::layout(this->stages_count, this->weakly_count, this->table_count, this->block, this->arrays);
+  if (!this->validate()) {
+    if (this->mapped != NULL) {
+      munmap(this->mapped, this->mapped_size);
+    }
+    else {
+      delete[] this->block;
+    }
+    throw Php::Exception("Simple Image: Wrong classifier format");
+  }
+}
+
+/**
+ * CompiledCascade destructor.
+ */
+CompiledCascade::~CompiledCascade() {
+  if (this->mapped != NULL) {
+    munmap(this->mapped, this->mapped_size);
+  }
+  else {
+    delete[] this->block;
+  }
+}
+
+/**
+ * Get classifier size property.
+ */
+int CompiledCascade::getSize() {
+  return this->size;
+}
+
+/**
+ * Get classifier size after scaling by value given steps count.
+ */
+int CompiledCascade::scaledSize(unsigned int scale_steps, float scale_step) {
+  int size = this->size;
+  for (unsigned int i = 0; i < scale_steps; i++) {
+    size *= scale_step;
+  }
+  return size;
+}
+
+/**
+ * Get forceful classifiers count.
+ */
+unsigned int CompiledCascade::stagesCount() {
+  return this->stages_count;
+}
+
+/**
+ * Get weakly classifiers count.
+ */
+unsigned int CompiledCascade::weaklyCount() {
+  return this->weakly_count;
+}
+
+/**
+ * Get lookup tables values count.
+ */
+unsigned int CompiledCascade::tableCount() {
+  return this->table_count;
+}
+
+/**
+ * Check, that classifier is soft cascade.
+ */
+bool CompiledCascade::isSoft() {
+  return this->soft;
+}
+
+/**
+ * Get compiled arrays.
+ */
+compiled_cascade_arrays& CompiledCascade::getArrays() {
+  return this->arrays;
+}
+
+/**
+ * Save classifier in binary file.
+ */
+bool CompiledCascade::save(std::string path) {
+  compiled_cascade_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "SIMGCASC", 8);
+  header.version = compiled_cascade_version;
+  header.size = this->size;
+  header.stages_count = this->stages_count;
+  header.weakly_count = this->weakly_count;
+  header.table_count = this->table_count;
+  header.flags = this->soft ? compiled_cascade_soft : 0;
+  header.block_size = CompiledCascade::blockSize(this->stages_count, this->weakly_count, this->table_count);
+  header.checksum = CompiledCascade::checksum(this->block, header.block_size);
+
+  std::ofstream file(path, std::ios::binary);
+  file.write((const char*) &header, sizeof(header));
+  file.write(this->block, header.block_size);
+  file.close();
+  return !file.fail();
+}
+
+/**
+ * Check, that file is binary model.
+ */
+bool CompiledCascade::isBinaryFile(std::string path) {
+  char magic[8];
+  std::ifstream file(path, std::ios::binary);
+  return file.read(magic, 8) && memcmp(magic, "SIMGCASC", 8) == 0;
+}
+
+/**
+ * Check arrays values, so detection never reads outside window.
+ *
+ * Features bounds are compared without sums, so file values can not
+ * overflow them. Size is bounded before it is scaled.
+ */
+bool CompiledCascade::validate() {
+  if (this->stages_count == 0 || this->size <= 0 || this->size > sample_max_size || this->arrays.stage_first[0] != 0 || this->arrays.stage_first[this->stages_count] != this->weakly_count) {
+    return false;
+  }
+  for (unsigned int i = 0; i < this->stages_count; i++) {
+    if (this->arrays.stage_first[i] > this->arrays.stage_first[i + 1]) {
+      return false;
+    }
+  }
+  for (unsigned int i = 0; i < this->weakly_count; i++) {
+    if (this->arrays.feature_type[i] < 0 || this->arrays.feature_type[i] > 3
+        || this->arrays.feature_x[i] < 0 || this->arrays.feature_y[i] < 0
+        || this->arrays.feature_w[i] < 0 || this->arrays.feature_h[i] < 0
+        || this->arrays.feature_w[i] > this->size - this->arrays.feature_x[i]
+        || this->arrays.feature_h[i] > this->size - this->arrays.feature_y[i]) {
+      return false;
+    }
+    if (this->arrays.table_bins[i] != 0 && (!(this->arrays.table_bin_width[i] > 0)
+        || this->arrays.table_first[i] > this->table_count || this->arrays.table_bins[i] > this->table_count - this->arrays.table_first[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Calculate block checksum.
+ */
+unsigned int CompiledCascade::checksum(const char *block, size_t block_size) {
+  unsigned int result = 2166136261u;
+  for (size_t i = 0; i < block_size; i++) {
+    result = (result ^ (unsigned char) block[i]) * 16777619u;
+  }
+  return result;
+}
+
+/**
+ * Get arrays block size in bytes.
+ */
+size_t CompiledCascade::blockSize(unsigned int stages_count, unsigned int weakly_count, unsigned int table_count) {
+  return ((size_t) 2 * stages_count + 1 + (size_t) 12 * weakly_count + table_count) * 4;
+}
+
+/**
+ * Place arrays in block.
+ *
+ * All arrays items have 4 bytes size, so arrays follow each other
+ * without padding. Arrays added by format versions are placed last, so
+ * old versions blocks are the beginning of the current block.
+ */
+void CompiledCascade::layout(unsigned int stages_count, unsigned int weakly_count, unsigned int table_count, char *block, compiled_cascade_arrays &arrays) {
+  size_t offset = 0;
+  arrays.stage_first = (unsigned int*) (block + offset);
+  offset += (stages_count + 1) * sizeof(unsigned int);
+  arrays.stage_limit = (float*) (block + offset);
+  offset += stages_count * sizeof(float);
+  arrays.feature_type = (int*) (block + offset);
+  offset += weakly_count * sizeof(int);
+  arrays.feature_x = (int*) (block + offset);
+  offset += weakly_count * sizeof(int);
+  arrays.feature_y = (int*) (block + offset);
+  offset += weakly_count * sizeof(int);
+  arrays.feature_w = (int*) (block + offset);
+  offset += weakly_count * sizeof(int);
+  arrays.feature_h = (int*) (block + offset);
+  offset += weakly_count * sizeof(int);
+  arrays.weakly_limit = (float*) (block + offset);
+  offset += weakly_count * sizeof(float);
+  arrays.weakly_weight = (float*) (block + offset);
+  offset += weakly_count * sizeof(float);
+  arrays.weakly_state = (int*) (block + offset);
+  offset += weakly_count * sizeof(int);
+  arrays.table_bins = (unsigned int*) (block + offset);
+  offset += weakly_count * sizeof(unsigned int);
+  arrays.table_bin_width = (float*) (block + offset);
+  offset += weakly_count * sizeof(float);
+  arrays.table_first = (unsigned int*) (block + offset);
+  offset += weakly_count * sizeof(unsigned int);
+  arrays.table_values = (float*) (block + offset);
+  offset += table_count * sizeof(float);
+  arrays.weakly_rejection = (float*) (block + offset);
+}
@@ -0,0 +1,132 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Binary model file format version.
+// Versions 1 without lookup tables and 2 without soft cascade are still loaded.
+const unsigned int compiled_cascade_version = 3;
+
+// Binary model flag of soft cascade.
+const unsigned int compiled_cascade_soft = 1;
+
+// Binary model file header, arrays block follows it.
+struct compiled_cascade_header {
+  // File signature "SIMGCASC".
+  char magic[8];
+  // Format version.
+  unsigned int version;
+  // Classifier basis variable.
+  int size;
+  // Classifiers counts.
+  unsigned int stages_count;
+  unsigned int weakly_count;
+  // Arrays block size in bytes.
+  unsigned long long block_size;
+  // Arrays block FNV-1a checksum.
+  unsigned int checksum;
+  // Lookup tables values count, zero in version 1.
+  unsigned int table_count;
+  // Model flags, header of versions 1 and 2 ends before them, unknown
+  // flags are rejected.
+  unsigned int flags;
+  // Reserved, must be zero, other values are rejected.
+  unsigned int reserved;
+};
+
+// Compiled cascade arrays structure, all arrays are parts of one block.
+struct compiled_cascade_arrays {
+  // First weakly classifier index of each stage, stages count + 1 items.
+  unsigned int *stage_first;
+  // Forceful classifiers limits.
+  float *stage_limit;
+  // Haar features of weakly classifiers.
+  int *feature_type;
+  int *feature_x;
+  int *feature_y;
+  int *feature_w;
+  int *feature_h;
+  // Weakly classifiers limits, weights and states.
+  float *weakly_limit;
+  float *weakly_weight;
+  int *weakly_state;
+  // Lookup tables bins counts, zero for threshold classifiers, bins widths
+  // and first values indexes of weakly classifiers.
+  unsigned int *table_bins;
+  float *table_bin_width;
+  unsigned int *table_first;
+  // Lookup tables values of all weakly classifiers.
+  float *table_values;
+  // Soft cascade score rejection limits after weakly classifiers.
+  float *weakly_rejection;
+};
+
+/**
+ * Cascade classifier compiled to flat struct-of-arrays form.
+ *
+ * Holds the loaded model without any pointers between classifiers and is
+ * not changed after building, so it can be shared by detection threads.
+ * Saved binary model is the header and the arrays block as is, so loading
+ * maps file in memory and only checks it.
+ */
+class CompiledCascade {
+  public:
+    // Compiled cascade constructor and destructor.
+    CompiledCascade(CascadeClassifier *cascade_classifier);
+    CompiledCascade(std::vector<ForcefulClassifier*> forceful_classifiers, int size);
+    CompiledCascade(std::string path);
+    ~CompiledCascade();
+    // Get classifier size property.
+    int getSize();
+    // Get classifier size after scaling by value given steps count.
+    int scaledSize(unsigned int scale_steps, float scale_step);
+    // Get forceful classifiers count.
+    unsigned int stagesCount();
+    // Get weakly classifiers count.
+    unsigned int weaklyCount();
+    // Get lookup tables values count.
+    unsigned int tableCount();
+    // Check, that classifier is soft cascade.
+    bool isSoft();
+    // Get compiled arrays.
+    compiled_cascade_arrays& getArrays();
+    // Save classifier in binary file.
+    bool save(std::string path);
+    // Check, that file is binary model.
+    static bool isBinaryFile(std::string path);
+    // Get arrays block size in bytes.
+    static size_t blockSize(unsigned int stages_count, unsigned int weakly_count, unsigned int table_count);
+    // Place arrays in block.
+    static void layout(unsigned int stages_count, unsigned int weakly_count, unsigned int table_count, char *block, compiled_cascade_arrays &arrays);
+  protected:
+    // Classifier basis variable.
+    int size;
+    // Classifiers counts.
+    unsigned int stages_count, weakly_count;
+    // Lookup tables values count.
+    unsigned int table_count;
+    // Soft cascade flag.
+    bool soft;
+    // Arrays memory block.
+    char *block;
+    // Mapped binary file and it size, block points inside it.
+    void *mapped;
+    size_t mapped_size;
+    // Arrays placed in memory block.
+    compiled_cascade_arrays arrays;
+    // Check arrays values, so detection never reads outside window.
+    bool validate();
+    // Calculate block checksum.
+    static unsigned int checksum(const char *block, size_t block_size);
+};
@@ -0,0 +1,243 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <vector>
+#include <chrono>
+#include "SimpleImageHelpers.h"
+#include "HaarFeature.h"
+#include "WeaklyClassifier.h"
+#include "ForcefulClassifier.h"
+#include "CascadeClassifier.h"
+#include "CompiledCascade.h"
+#include "ScaledCascade.h"
+#include "ThreadPool.h"
+#include "DetectionEngine.h"
+
+// Approximate windows count per detection task.
+const unsigned int windows_per_task = 4096;
+
+/**
+ * DetectionEngine constructor.
+ */
+DetectionEngine::DetectionEngine(CompiledCascade *compiled_cascade, unsigned int columns, unsigned int rows, float scale_step, float slide_step, float scale_value) {
+  this->columns = columns;
+  this->rows = rows;
+  this->slide_step = slide_step;
+
+  unsigned int size = compiled_cascade->getSize(), previous_size = 0;
+  while (size <= rows && size <= columns && size > previous_size) {
+    this->scales.push_back(new ScaledCascade(compiled_cascade, this->scales.size(), scale_step, scale_value, columns + 1));
+    previous_size = size;
+    size = compiled_cascade->scaledSize(this->scales.size(), scale_step);
+  }
+
+  // Split windows rows of each scale in bands of similar windows count.
+  detection_task task;
+  unsigned int slide, windows_columns, windows_rows, band_rows;
+  for (unsigned int i = 0; i < this->scales.size(); i++) {
+    size = this->scales[i]->getSize();
+    slide = this->slide(i);
+    windows_columns = (columns - size) / slide + 1;
+    windows_rows = (rows - size) / slide + 1;
+    band_rows = windows_per_task / windows_columns;
+    if (band_rows < 1) {
+      band_rows = 1;
+    }
+    task.scale_index = i;
+    for (unsigned int row = 0; row < windows_rows; row += band_rows) {
+      task.first_row = row;
+      task.last_row = row + band_rows < windows_rows ? row + band_rows : windows_rows;
+      this->tasks.push_back(task);
+    }
+  }
+}
+
+/**
+ * DetectionEngine destructor.
+ */
+DetectionEngine::~DetectionEngine() {
+  for (unsigned int i = 0; i < this->scales.size(); i++) {
+    delete this->scales[i];
+  }
+}
+
+/**
+ * Get scales count.
+ */
+unsigned int DetectionEngine::scalesCount() {
+  return this->scales.size();
+}
+
+/**
+ * Get windows slide for scale.
+ */
+unsigned int DetectionEngine::slide(unsigned int scale_index) {
+  int slide = this->scales[scale_index]->getSize() * this->slide_step;
+  if (slide < 1) {
+    slide = 1;
+  }
+  return slide;
+}
+
+/**
+ * Detect objects on integral images and put them in detection manager.
+ */
+void DetectionEngine::detect(float *integral_image, float *squared_integral_image, ThreadPool *thread_pool, DetectionManager *detection_manager) {
+  std::vector<std::vector<detection_structure> > detections(this->tasks.size());
+  thread_pool->run(this->tasks.size(), [&](unsigned int worker_index, unsigned int task_index) {
+    this->detectTask(this->tasks[task_index], integral_image, squared_integral_image, detections[task_index]);
+  });
+
+  // Merge detections in tasks order, so result does not depend on threads.
+  for (unsigned int i = 0; i < detections.size(); i++) {
+    for (unsigned int j = 0; j < detections[i].size(); j++) {
+      detection_manager->addDetection(detections[i][j].x, detections[i][j].y, detections[i][j].size, detections[i][j].margin);
+    }
+  }
+}
+
+/**
+ * Profile detection on integral images, get statistics of every scale.
+ *
+ * Every scale is detected alone by batches, as in detection, and timed.
+ * Statistics are collected after that by single window classification,
+ * which accepts the same windows, so timing is not affected by counters.
+ */
+void DetectionEngine::profile(float *integral_image, float *squared_integral_image, ThreadPool *thread_pool, std::vector<scale_profile> &profiles) {
+  std::vector<unsigned int> scale_tasks;
+  std::vector<std::vector<detection_structure> > detections;
+  std::vector<cascade_stats> tasks_stats;
+  std::chrono::steady_clock::time_point start;
+
+  profiles.resize(this->scales.size());
+  for (unsigned int i = 0; i < this->scales.size(); i++) {
+    scale_tasks.clear();
+    for (unsigned int j = 0; j < this->tasks.size(); j++) {
+      if (this->tasks[j].scale_index == i) {
+        scale_tasks.push_back(j);
+      }
+    }
+    detections.assign(scale_tasks.size(), std::vector<detection_structure>());
+    start = std::chrono::steady_clock::now();
+    thread_pool->run(scale_tasks.size(), [&](unsigned int worker_index, unsigned int task_index) {
+      this->detectTask(this->tasks[scale_tasks[task_index]], integral_image, squared_integral_image, detections[task_index]);
+    });
+    profiles[i].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    profiles[i].size = this->scales[i]->getSize();
+
+    tasks_stats.assign(scale_tasks.size(), cascade_stats());
+    thread_pool->run(scale_tasks.size(), [&](unsigned int worker_index, unsigned int task_index) {
+      detection_task &task = this->tasks[scale_tasks[task_index]];
+      reset_cascade_stats(tasks_stats[task_index], this->scales[i]->stagesCount());
+      profile_windows_rows(this->scales[i], integral_image, squared_integral_image, this->columns, this->slide(i), task.first_row, task.last_row, tasks_stats[task_index]);
+    });
+    reset_cascade_stats(profiles[i].stats, this->scales[i]->stagesCount());
+    for (unsigned int j = 0; j < tasks_stats.size(); j++) {
+      merge_cascade_stats(profiles[i].stats, tasks_stats[j]);
+    }
+  }
+}
+
+/**
+ * Detect objects in one task.
+ */
+void DetectionEngine::detectTask(detection_task &task, float *integral_image, float *squared_integral_image, std::vector<detection_structure> &detections) {
+  detect_windows_rows(this->scales[task.scale_index], integral_image, squared_integral_image, this->columns, this->slide(task.scale_index), task.first_row, task.last_row, detections);
+}
+
+/**
+ * Calculate window mean and standard deviation from integral images.
+ *
+ * Corners far from origin are large, so sums and variance are calculated
+ * in double. Stored corners are rounded to float, so variance below their
+ * rounding error bound is taken as zero. Get false for window with zero
+ * deviation, such flat window is not classified.
+ */
+static inline bool window_variables(const float *window, const float *squared_window, unsigned int size, unsigned int bottom_offset, float &temp1, float &temp2) {
+  double area = (double) size * size;
+  double mean = ((double) window[bottom_offset + size] - window[bottom_offset] - window[size] + window[0]) / area;
+  double variance = ((double) squared_window[bottom_offset + size] - squared_window[bottom_offset] - squared_window[size] + squared_window[0]) / area - mean * mean;
+  double mean_error = FLT_EPSILON * ((double) fabs(window[bottom_offset + size]) + fabs(window[bottom_offset]) + fabs(window[size]) + fabs(window[0])) / area;
+  double variance_error = FLT_EPSILON * ((double) fabs(squared_window[bottom_offset + size]) + fabs(squared_window[bottom_offset]) + fabs(squared_window[size]) + fabs(squared_window[0])) / area
+    + (2 * fabs(mean) + mean_error) * mean_error;
+  temp1 = mean;
+  temp2 = variance > variance_error ? sqrt(variance) : 0;
+  return temp2 > 0;
+}
+
+/**
+ * Classify windows rows band by scaled cascade on padded integral images.
+ *
+ * Integral images row stride is taken from scaled cascade, detections are
+ * given in integral images coordinates.
+ */
+void detect_windows_rows(ScaledCascade *scaled_cascade, float *integral_image, float *squared_integral_image, unsigned int columns, unsigned int slide, unsigned int first_row, unsigned int last_row, std::vector<detection_structure> &detections) {
+  unsigned int size = scaled_cascade->getSize(), stride = scaled_cascade->getStride();
+  unsigned int windows_columns = (columns - size) / slide + 1, bottom_offset = size * stride, count, mask, valid;
+  float temp1[cascade_batch_size], temp2[cascade_batch_size], *window, *squared_window;
+  detection_structure detection;
+
+  for (unsigned int y = first_row * slide; y < last_row * slide; y += slide) {
+    // Classify neighbour windows of row by batches.
+    for (unsigned int column = 0; column < windows_columns; column += cascade_batch_size) {
+      count = windows_columns - column < cascade_batch_size ? windows_columns - column : cascade_batch_size;
+      valid = 0;
+      for (unsigned int i = 0; i < count; i++) {
+        window = integral_image + y * stride + (column + i) * slide;
+        squared_window = squared_integral_image + y * stride + (column + i) * slide;
+        if (window_variables(window, squared_window, size, bottom_offset, temp1[i], temp2[i])) {
+          valid |= 1u << i;
+        }
+      }
+      if (valid == 0) {
+        continue;
+      }
+      // Classify windows by calculated values, flat windows are dropped.
+      mask = scaled_cascade->classifyWindows(integral_image + y * stride + column * slide, slide, count, temp1, temp2) & valid;
+      for (unsigned int i = 0; mask != 0; i++, mask >>= 1) {
+        if (mask & 1) {
+          detection.x = (column + i) * slide;
+          detection.y = y;
+          detection.size = size;
+          detection.margin = scaled_cascade->lastStageMargin(integral_image + y * stride + detection.x, temp1[i], temp2[i]);
+          detections.push_back(detection);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Classify windows rows band one by one and collect statistics.
+ */
+void profile_windows_rows(ScaledCascade *scaled_cascade, float *integral_image, float *squared_integral_image, unsigned int columns, unsigned int slide, unsigned int first_row, unsigned int last_row, cascade_stats &stats) {
+  unsigned int size = scaled_cascade->getSize(), stride = scaled_cascade->getStride();
+  unsigned int windows_columns = (columns - size) / slide + 1, bottom_offset = size * stride;
+  float temp1, temp2, *window;
+
+  for (unsigned int y = first_row * slide; y < last_row * slide; y += slide) {
+    for (unsigned int column = 0; column < windows_columns; column++) {
+      window = integral_image + y * stride + column * slide;
+      // Flat windows are not classified, as by detection.
+      if (window_variables(window, squared_integral_image + y * stride + column * slide, size, bottom_offset, temp1, temp2)) {
+        scaled_cascade->classifyWindow(window, temp1, temp2, stats);
+      }
+    }
+  }
+}
@@ -0,0 +1,70 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Detection task structure, holds windows rows band of one scale.
+struct detection_task {
+  unsigned int scale_index;
+  unsigned int first_row;
+  unsigned int last_row;
+};
+
+// Detection profile of one scale.
+struct scale_profile {
+  // Scaled classifier size.
+  unsigned int size;
+  // Scale detection time in seconds.
+  double seconds;
+  // Scale classification statistics.
+  cascade_stats stats;
+};
+
+/**
+ * Multi-scale sliding window detection engine.
+ *
+ * Every scale has own immutable compiled cascade, scaled before detection,
+ * so scales and windows rows bands are classified in parallel. Integral
+ * images must have zero first row and column.
+ */
+class DetectionEngine {
+  public:
+    // Detection engine constructor and destructor.
+    DetectionEngine(CompiledCascade *compiled_cascade, unsigned int columns, unsigned int rows, float scale_step, float slide_step, float scale_value);
+    ~DetectionEngine();
+    // Get scales count.
+    unsigned int scalesCount();
+    // Detect objects on integral images and put them in detection manager.
+    void detect(float *integral_image, float *squared_integral_image, ThreadPool *thread_pool, DetectionManager *detection_manager);
+    // Profile detection on integral images, get statistics of every scale.
+    void profile(float *integral_image, float *squared_integral_image, ThreadPool *thread_pool, std::vector<scale_profile> &profiles);
+  protected:
+    // Image sizes.
+    unsigned int columns, rows;
+    // Slide step value.
+    float slide_step;
+    // Scaled cascade classifiers set.
+    std::vector<ScaledCascade*> scales;
+    // Detection tasks set.
+    std::vector<detection_task> tasks;
+    // Get windows slide for scale.
+    unsigned int slide(unsigned int scale_index);
+    // Detect objects in one task.
+    void detectTask(detection_task &task, float *integral_image, float *squared_integral_image, std::vector<detection_structure> &detections);
+};
+
+// Classify windows rows band by scaled cascade on padded integral images.
+void detect_windows_rows(ScaledCascade *scaled_cascade, float *integral_image, float *squared_integral_image, unsigned int columns, unsigned int slide, unsigned int first_row, unsigned int last_row, std::vector<detection_structure> &detections);
+// Classify windows rows band one by one and collect statistics.
+void profile_windows_rows(ScaledCascade *scaled_cascade, float *integral_image, float *squared_integral_image, unsigned int columns, unsigned int slide, unsigned int first_row, unsigned int last_row, cascade_stats &stats);
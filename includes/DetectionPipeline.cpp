@@ -0,0 +1,228 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <phpcpp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include "SimpleImageHelpers.h"
+#include "HaarFeature.h"
+#include "WeaklyClassifier.h"
+#include "ForcefulClassifier.h"
+#include "CascadeClassifier.h"
+#include "CompiledCascade.h"
+#include "ScaledCascade.h"
+#include "ThreadPool.h"
+#include "IntegralImages.h"
+#include "DetectionEngine.h"
+#include "PyramidDetectionEngine.h"
+#include "DetectionPipeline.h"
+
+/**
+ * DetectionPipeline constructor.
+ */
+DetectionPipeline::DetectionPipeline(CompiledCascade *compiled_cascade, float scale_step, float slide_step, float scale_value, bool pyramid, ThreadPool *thread_pool, unsigned int decoders_count) {
+  this->compiled_cascade = compiled_cascade;
+  this->scale_step = scale_step;
+  this->slide_step = slide_step;
+  this->scale_value = scale_value;
+  this->pyramid = pyramid;
+  this->thread_pool = thread_pool;
+  this->decoders_count = decoders_count > 0 ? decoders_count : 1;
+  this->queue_capacity = 2 * this->decoders_count;
+  this->engine = NULL;
+  this->pyramid_engine = NULL;
+  this->engine_columns = 0;
+  this->engine_rows = 0;
+}
+
+/**
+ * DetectionPipeline destructor.
+ */
+DetectionPipeline::~DetectionPipeline() {
+  delete this->engine;
+  delete this->pyramid_engine;
+}
+
+/**
+ * Detect objects on every file.
+ *
+ * Every file gets exactly one callback, files are not reported in order.
+ * When callback throws, decoders are stopped and exception is rethrown.
+ */
+void DetectionPipeline::run(const std::vector<std::string> &files, pipeline_detected_callback detected, pipeline_failed_callback failed) {
+  std::vector<std::thread> decoders;
+  pipeline_image *image;
+  unsigned int index;
+  std::string error;
+
+  this->next_file = 0;
+  this->stopped = false;
+  for (unsigned int i = 0; i < this->decoders_count && i < files.size(); i++) {
+    decoders.push_back(std::thread(&DetectionPipeline::decode, this, &files));
+  }
+  try {
+    for (unsigned int i = 0; i < files.size(); i++) {
+      {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->ready.wait(lock, [this] { return !this->queue.empty(); });
+        image = this->queue.front();
+        this->queue.pop_front();
+      }
+      this->space.notify_one();
+
+      index = image->index;
+      error = image->error;
+      DetectionManager detection_manager;
+      if (error.empty()) {
+        try {
+          this->detect(image, detection_manager);
+        }
+        catch (std::exception &detection_error) {
+          error = detection_error.what();
+        }
+      }
+      this->release(image);
+      if (error.empty()) {
+        detected(index, detection_manager);
+      }
+      else {
+        failed(index, error);
+      }
+    }
+  }
+  catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->stopped = true;
+    }
+    this->space.notify_all();
+    for (unsigned int i = 0; i < decoders.size(); i++) {
+      decoders[i].join();
+    }
+    while (!this->queue.empty()) {
+      this->release(this->queue.front());
+      this->queue.pop_front();
+    }
+    throw;
+  }
+  for (unsigned int i = 0; i < decoders.size(); i++) {
+    decoders[i].join();
+  }
+}
+
+/**
+ * Decode files until all are taken.
+ */
+void DetectionPipeline::decode(const std::vector<std::string> *files) {
+  unsigned int index;
+  pipeline_image *image;
+
+  while ((index = this->next_file++) < files->size()) {
+    image = this->decodeImage(index, (*files)[index]);
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->space.wait(lock, [this] { return this->stopped || this->queue.size() < this->queue_capacity; });
+      if (this->stopped) {
+        lock.unlock();
+        this->release(image);
+        return;
+      }
+      this->queue.push_back(image);
+    }
+    this->ready.notify_one();
+  }
+}
+
+/**
+ * Decode one image file.
+ *
+ * Errors are kept in image, so every file reaches detection queue.
+ */
+pipeline_image* DetectionPipeline::decodeImage(unsigned int index, const std::string &file) {
+  pipeline_image *image = new pipeline_image();
+  image->index = index;
+  image->columns = 0;
+  image->rows = 0;
+  image->integral_image = NULL;
+  image->squared_integral_image = NULL;
+  if (!file_is_exist(file)) {
+    image->error = "Simple Image: Image file not exist";
+    return image;
+  }
+  try {
+    Magick::Image magick_image;
+    magick_image.read(file);
+    magick_image.type(Magick::GrayscaleType);
+    image->columns = magick_image.columns();
+    image->rows = magick_image.rows();
+    if (this->pyramid) {
+      image->pixels.resize(image->columns * image->rows);
+      image_pixels_shade(magick_image, image->pixels.data());
+    }
+    else {
+      image->integral_image = IntegralImages::allocate(image->columns, image->rows);
+      image->squared_integral_image = IntegralImages::allocate(image->columns, image->rows);
+      image_integral_images(magick_image, image->integral_image, image->squared_integral_image);
+    }
+  }
+  catch (std::exception &error) {
+    image->error = error.what();
+  }
+  return image;
+}
+
+/**
+ * Detect objects on decoded image.
+ */
+void DetectionPipeline::detect(pipeline_image *image, DetectionManager &detection_manager) {
+  if (image->columns != this->engine_columns || image->rows != this->engine_rows) {
+    delete this->engine;
+    delete this->pyramid_engine;
+    this->engine = NULL;
+    this->pyramid_engine = NULL;
+    this->engine_columns = image->columns;
+    this->engine_rows = image->rows;
+  }
+  if (this->pyramid) {
+    if (this->pyramid_engine == NULL) {
+      this->pyramid_engine = new PyramidDetectionEngine(this->compiled_cascade, image->columns, image->rows, this->scale_step, this->slide_step, this->scale_value);
+    }
+    this->pyramid_engine->detect(image->pixels.data(), this->thread_pool, &detection_manager);
+  }
+  else {
+    if (this->engine == NULL) {
+      this->engine = new DetectionEngine(this->compiled_cascade, image->columns, image->rows, this->scale_step, this->slide_step, this->scale_value);
+    }
+    this->engine->detect(image->integral_image, image->squared_integral_image, this->thread_pool, &detection_manager);
+  }
+}
+
+/**
+ * Release decoded image.
+ */
+void DetectionPipeline::release(pipeline_image *image) {
+  free(image->integral_image);
+  free(image->squared_integral_image);
+  delete image;
+}
@@ -0,0 +1,91 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+// Decoded image structure, passed from decoders to detection.
+struct pipeline_image {
+  unsigned int index;
+  unsigned int columns;
+  unsigned int rows;
+  // Pixels shade for pyramid detection.
+  std::vector<float> pixels;
+  // Integral images for scaled cascade detection.
+  float *integral_image;
+  float *squared_integral_image;
+  // Decoding error message, empty on success.
+  std::string error;
+};
+
+// Callback of detected image, receives file index and detections.
+typedef std::function<void(unsigned int, DetectionManager&)> pipeline_detected_callback;
+// Callback of failed image, receives file index and error message.
+typedef std::function<void(unsigned int, const std::string&)> pipeline_failed_callback;
+
+/**
+ * Images detection pipeline.
+ *
+ * Decoder threads read image files, convert them to grayscale and prepare
+ * detection input, pixels shade for pyramid or integral images otherwise.
+ * The calling thread takes decoded images in order of readiness and
+ * detects objects on them by thread pool, so decoding of next images is
+ * overlapped with detection. Decoded images queue is bounded, decoders
+ * wait, when detection is behind. Detection engine is reused while images
+ * have the same size. Callbacks are called on the calling thread.
+ */
+class DetectionPipeline {
+  public:
+    // Detection pipeline constructor and destructor.
+    DetectionPipeline(CompiledCascade *compiled_cascade, float scale_step, float slide_step, float scale_value, bool pyramid, ThreadPool *thread_pool, unsigned int decoders_count);
+    ~DetectionPipeline();
+    // Detect objects on every file.
+    void run(const std::vector<std::string> &files, pipeline_detected_callback detected, pipeline_failed_callback failed);
+  protected:
+    // Detection params.
+    CompiledCascade *compiled_cascade;
+    float scale_step, slide_step, scale_value;
+    bool pyramid;
+    // Detection thread pool and decoders count.
+    ThreadPool *thread_pool;
+    unsigned int decoders_count;
+    // Decoded images queue, its guard and notifications.
+    std::deque<pipeline_image*> queue;
+    unsigned int queue_capacity;
+    std::mutex mutex;
+    std::condition_variable ready, space;
+    // Next file index to decode and stop flag.
+    std::atomic<unsigned int> next_file;
+    bool stopped;
+    // Detection engines of the last image size.
+    DetectionEngine *engine;
+    PyramidDetectionEngine *pyramid_engine;
+    unsigned int engine_columns, engine_rows;
+    // Decode files until all are taken.
+    void decode(const std::vector<std::string> *files);
+    // Decode one image file.
+    pipeline_image* decodeImage(unsigned int index, const std::string &file);
+    // Detect objects on decoded image.
+    void detect(pipeline_image *image, DetectionManager &detection_manager);
+    // Release decoded image.
+    void release(pipeline_image *image);
+};
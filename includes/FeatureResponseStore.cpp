@@ -0,0 +1,178 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <phpcpp.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <vector>
+#include <algorithm>
+#include "HaarFeature.h"
+#include "ThreadPool.h"
+#include "FeatureResponseStore.h"
+
+/**
+ * Compare samples indexes by feature values.
+ */
+class FeatureValueCompare {
+  public:
+    FeatureValueCompare(float *values) {
+      this->values = values;
+    }
+    bool operator()(unsigned int a, unsigned int b) const {
+      return this->values[a] < this->values[b] || (this->values[a] == this->values[b] && a < b);
+    }
+  protected:
+    float *values;
+};
+
+/**
+ * FeatureResponseStore constructor.
+ */
+FeatureResponseStore::FeatureResponseStore(std::vector<HaarFeature*> &haar_features, std::vector<float*> &positive_samples, std::vector<float*> &negative_samples, int size, ThreadPool *thread_pool, size_t memory_limit) {
+  this->features_count = haar_features.size();
+  this->samples_count = positive_samples.size() + negative_samples.size();
+  this->block = NULL;
+  this->block_size = 0;
+  this->mapped = false;
+  this->allocate(memory_limit);
+
+  // Each worker has own values buffer.
+  std::vector<std::vector<float> > values(thread_pool->size(), std::vector<float>(this->samples_count));
+  thread_pool->run(this->features_count, [&](unsigned int worker_index, unsigned int feature_index) {
+    this->computeFeature(feature_index, haar_features[feature_index], positive_samples, negative_samples, size, values[worker_index].data());
+  });
+}
+
+/**
+ * FeatureResponseStore destructor.
+ */
+FeatureResponseStore::~FeatureResponseStore() {
+  if (this->mapped) {
+    munmap(this->block, this->block_size);
+  }
+  else {
+    delete[] this->block;
+  }
+}
+
+/**
+ * Get features count.
+ */
+unsigned int FeatureResponseStore::featuresCount() {
+  return this->features_count;
+}
+
+/**
+ * Get samples count.
+ */
+unsigned int FeatureResponseStore::samplesCount() {
+  return this->samples_count;
+}
+
+/**
+ * Get feature values sorted ascending.
+ */
+float* FeatureResponseStore::sortedValues(unsigned int feature_index) {
+  return (float*) (this->block + (size_t) feature_index * this->samples_count * (sizeof(float) + sizeof(unsigned int)));
+}
+
+/**
+ * Get samples indexes sorted by feature value.
+ */
+unsigned int* FeatureResponseStore::sortedIndexes(unsigned int feature_index) {
+  return (unsigned int*) (this->sortedValues(feature_index) + this->samples_count);
+}
+
+/**
+ * Check, that store is kept in memory-mapped file.
+ */
+bool FeatureResponseStore::isMapped() {
+  return this->mapped;
+}
+
+/**
+ * Allocate store memory block.
+ *
+ * Store bigger than memory limit is placed in unlinked temporary file,
+ * so the kernel can page it out instead of failing the training.
+ */
+void FeatureResponseStore::allocate(size_t memory_limit) {
+  this->block_size = (size_t) this->features_count * this->samples_count * (sizeof(float) + sizeof(unsigned int));
+  if (memory_limit == 0) {
+    memory_limit = default_training_memory_limit();
+  }
+  if (this->block_size <= memory_limit) {
+    this->block = new char[this->block_size];
+    return;
+  }
+
+  const char *temp_dir = getenv("TMPDIR");
+  std::string file_template = std::string(temp_dir != NULL && temp_dir[0] != '\0' ? temp_dir : "/tmp") + "/simple_image_features_XXXXXX";
+  std::vector<char> file_name(file_template.begin(), file_template.end());
+  file_name.push_back('\0');
+  int file = mkstemp(file_name.data());
+  if (file < 0) {
+    throw Php::Exception("Simple Image: Can not create features store file");
+  }
+  unlink(file_name.data());
+  if (ftruncate(file, this->block_size) != 0) {
+    close(file);
+    throw Php::Exception("Simple Image: Not enough disk space for features store file");
+  }
+  void *block = mmap(NULL, this->block_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+  close(file);
+  if (block == MAP_FAILED) {
+    throw Php::Exception("Simple Image: Can not map features store file");
+  }
+  this->block = (char*) block;
+  this->mapped = true;
+}
+
+/**
+ * Calculate feature values and sort samples by them.
+ */
+void FeatureResponseStore::computeFeature(unsigned int feature_index, HaarFeature *feature, std::vector<float*> &positive_samples, std::vector<float*> &negative_samples, int size, float *values) {
+  unsigned int positive_size = positive_samples.size(), negative_size = negative_samples.size();
+  float *sorted_values = this->sortedValues(feature_index);
+  unsigned int *sorted_indexes = this->sortedIndexes(feature_index);
+
+  for (unsigned int i = 0; i < positive_size; i++) {
+    values[i] = feature->value(positive_samples[i], size + 1, 1, 1);
+  }
+  for (unsigned int i = 0; i < negative_size; i++) {
+    values[positive_size + i] = feature->value(negative_samples[i], size + 1, 1, 1);
+  }
+  for (unsigned int i = 0; i < this->samples_count; i++) {
+    sorted_indexes[i] = i;
+  }
+  std::sort(sorted_indexes, sorted_indexes + this->samples_count, FeatureValueCompare(values));
+  for (unsigned int i = 0; i < this->samples_count; i++) {
+    sorted_values[i] = values[sorted_indexes[i]];
+  }
+}
+
+/**
+ * Get default memory limit for training stores - half of physical memory.
+ */
+size_t default_training_memory_limit() {
+  long pages = sysconf(_SC_PHYS_PAGES), page_size = sysconf(_SC_PAGESIZE);
+  if (pages <= 0 || page_size <= 0) {
+    return (size_t) 1 << 30;
+  }
+  return (size_t) pages * (size_t) page_size / 2;
+}
@@ -0,0 +1,58 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+class ThreadPool;
+
+/**
+ * Training-time store of Haar features responses.
+ *
+ * Keeps for every feature the values on all samples sorted ascending and
+ * the samples indexes in the same order. Samples indexes below positive
+ * samples count belong to positive samples. Samples are integral images
+ * with zero first row and column. When the store does not fit in memory
+ * limit, it is kept in memory-mapped temporary file.
+ */
+class FeatureResponseStore {
+  public:
+    // Feature response store constructor and destructor.
+    FeatureResponseStore(std::vector<HaarFeature*> &haar_features, std::vector<float*> &positive_samples, std::vector<float*> &negative_samples, int size, ThreadPool *thread_pool, size_t memory_limit = 0);
+    ~FeatureResponseStore();
+    // Get features count.
+    unsigned int featuresCount();
+    // Get samples count.
+    unsigned int samplesCount();
+    // Get feature values sorted ascending.
+    float* sortedValues(unsigned int feature_index);
+    // Get samples indexes sorted by feature value.
+    unsigned int* sortedIndexes(unsigned int feature_index);
+    // Check, that store is kept in memory-mapped file.
+    bool isMapped();
+  protected:
+    // Store sizes.
+    unsigned int features_count, samples_count;
+    // Store memory block and it size in bytes.
+    char *block;
+    size_t block_size;
+    // Memory-mapped file flag.
+    bool mapped;
+    // Allocate store memory block.
+    void allocate(size_t memory_limit);
+    // Calculate feature values and sort samples by them.
+    void computeFeature(unsigned int feature_index, HaarFeature *feature, std::vector<float*> &positive_samples, std::vector<float*> &negative_samples, int size, float *values);
+};
+
+// Get default memory limit for training stores.
+size_t default_training_memory_limit();
@@ -15,11 +15,17 @@ limitations under the License.
 */
 
 #include <string.h>
+#include <string>
 #include <vector>
+#include <limits>
 #include <algorithm>
+#include "SimpleImageHelpers.h"
 #include "HaarFeature.h"
 #include "WeaklyClassifier.h"
 #include "ForcefulClassifier.h"
+#include "CascadeClassifier.h"
+#include "CompiledCascade.h"
+#include "ScaledCascade.h"
 
 /**
  * ForcefulClassifier first constructor.
@@ -50,6 +56,32 @@ ForcefulClassifier::ForcefulClassifier(std::vector<WeaklyClassifier*> weakly_cla
   this->limit = limit;
 }
 
+/**
+ * Create deep classifier copy.
+ */
+ForcefulClassifier* ForcefulClassifier::copy() {
+  ForcefulClassifier *result = new ForcefulClassifier();
+  for (unsigned int i = 0; i < this->weakly_classifiers.size(); i++) {
+    result->addClassifier(this->weakly_classifiers[i]->copy(), this->weights[i]);
+  }
+  result->limit = this->limit;
+  result->rejections = this->rejections;
+  return result;
+}
+
+/**
+ * Remove weakly classifiers from memory.
+ */
+void ForcefulClassifier::destroyClassifiers() {
+  std::vector<WeaklyClassifier*>::iterator iterator;
+  for (iterator = this->weakly_classifiers.begin(); iterator != this->weakly_classifiers.end(); iterator++) {
+    delete *iterator;
+  }
+  this->weakly_classifiers.clear();
+  this->weights.clear();
+  this->rejections.clear();
+}
+
 /**
  * Get weakly classifiers set.
  */
@@ -57,6 +89,41 @@ std::vector<WeaklyClassifier*> ForcefulClassifier::getWeaklyClassifiers() {
   return this->weakly_classifiers;
 }
 
+/**
+ * Get weakly classifiers count.
+ */
+unsigned int ForcefulClassifier::weaklyCount() {
+  return this->weakly_classifiers.size();
+}
+
+/**
+ * Get weakly classifiers weights.
+ */
+std::vector<float> ForcefulClassifier::getWeights() {
+  return this->weights;
+}
+
+/**
+ * Get classifier limit.
+ */
+float ForcefulClassifier::getLimit() {
+  return this->limit;
+}
+
+/**
+ * Get soft cascade rejection limits.
+ */
+std::vector<float> ForcefulClassifier::getRejections() {
+  return this->rejections;
+}
+
+/**
+ * Set soft cascade rejection limits.
+ */
+void ForcefulClassifier::setRejections(std::vector<float> rejections) {
+  this->rejections = rejections;
+}
+
 /**
  * Scale each weakly classifier in set by value.
  */
@@ -80,17 +147,10 @@ void ForcefulClassifier::addClassifier(WeaklyClassifier* weakly_classifier, floa
  */
 void ForcefulClassifier::calculateLimit(std::vector<float*> &positive_samples, int size, float maximum_fnr) {
   unsigned int positive_size = positive_samples.size(), temp = maximum_fnr * positive_size;
-  int weights_index;
   float temp2, *counters = new float[positive_size];
-  std::vector<WeaklyClassifier*>::iterator iterator;
 
   for (unsigned int i = 0; i < positive_size; i++) {
-    counters[i] = 0;
-    weights_index = 0;
-    for (iterator = this->weakly_classifiers.begin(); iterator != this->weakly_classifiers.end(); iterator++) {
-      counters[i] += this->weights[weights_index] * (*iterator)->classifyImage(positive_samples[i], size, 0, 0, 0, 1);
-      weights_index++;
-    }
+    counters[i] = this->calculateScore(positive_samples[i], size + 1, 1, 1, 0, 1);
   }
   std::sort(counters, counters + positive_size);
   if (temp >= 0 && temp < positive_size) {
@@ -103,38 +163,122 @@ void ForcefulClassifier::calculateLimit(std::vector<float*> &positive_samples, i
   delete[] counters;
 }
 
+/**
+ * Calculate soft cascade limit and rejection limits.
+ *
+ * Scores of positive samples after each weakly classifier are carried from
+ * previous stages. Limit is calculated as usual by scores after the last
+ * weakly classifier. Each rejection limit is minimal score after its weakly
+ * classifier over positive samples accepted by limit, so rejections never
+ * reject them.
+ */
+void ForcefulClassifier::calculateRejections(std::vector<std::vector<float> > &positive_scores, float maximum_fnr) {
+  unsigned int weakly_count = positive_scores.size(), positive_size = weakly_count > 0 ? positive_scores[0].size() : 0, temp = maximum_fnr * positive_size, accepted = 0;
+  std::vector<float> sorted_scores;
+  float score;
+
+  if (positive_size > 0) {
+    sorted_scores = positive_scores[weakly_count - 1];
+    std::sort(sorted_scores.begin(), sorted_scores.end());
+    if (temp < positive_size) {
+      score = sorted_scores[temp];
+      while (temp > 0 && sorted_scores[temp] == score) {
+        temp--;
+      }
+      this->limit = sorted_scores[temp];
+    }
+  }
+
+  this->rejections.assign(weakly_count, std::numeric_limits<float>::max());
+  for (unsigned int i = 0; i < positive_size; i++) {
+    if (positive_scores[weakly_count - 1][i] < this->limit) {
+      continue;
+    }
+    accepted++;
+    for (unsigned int j = 0; j < weakly_count; j++) {
+      this->rejections[j] = std::min(this->rejections[j], positive_scores[j][i]);
+    }
+  }
+  // Without accepted samples nothing is rejected by weakly classifiers.
+  if (accepted == 0) {
+    this->rejections.assign(weakly_count, std::numeric_limits<float>::lowest());
+  }
+}
+
 /**
  * Calculate classifier FPR.
+ *
+ * Negative samples are classified by batches, as detection windows.
  */
 float ForcefulClassifier::calculateFpr(std::vector<float*> &negative_samples, int size) {
-  unsigned int negative_size = negative_samples.size();
-  int classify_image_count = 0;
+  CompiledCascade compiled_cascade(std::vector<ForcefulClassifier*>(1, this), size);
+  ScaledCascade scaled_cascade(&compiled_cascade, 0, 1, 1, size + 1);
+  return float(scaled_cascade.countAccepted(negative_samples)) / float(negative_samples.size());
+}
+
+/**
+ * Calculate soft cascade FPR.
+ *
+ * Negative sample is accepted, when its scores after weakly classifiers
+ * reach all rejection limits and its last score reaches limit, as by soft
+ * cascade classification.
+ */
+float ForcefulClassifier::calculateFpr(std::vector<std::vector<float> > &negative_scores) {
+  unsigned int weakly_count = negative_scores.size(), negative_size = weakly_count > 0 ? negative_scores[0].size() : 0, accepted = 0;
+  bool result;
   for (unsigned int i = 0; i < negative_size; i++) {
-    if (this->classifyImage(negative_samples[i], size, 0, 0, 0, 1)) {
-      classify_image_count++;
+    result = true;
+    for (unsigned int j = 0; j < weakly_count && result; j++) {
+      result = !(j < this->rejections.size() && negative_scores[j][i] < this->rejections[j]);
+    }
+    if (result && negative_scores[weakly_count - 1][i] >= this->limit) {
+      accepted++;
     }
   }
-  return float(classify_image_count) / float(negative_samples.size());
+  return float(accepted) / float(negative_size);
 }
 
 /**
- * Scale only limit by value.
+ * Scale only limit and soft cascade rejection limits by value.
  */
 void ForcefulClassifier::scaleLimitByValue(float value) {
   this->limit *= value;
+  for (unsigned int i = 0; i < this->rejections.size(); i++) {
+    this->rejections[i] *= value;
+  }
 }
 
 /**
- * Classify image by classifier.
+ * Calculate weakly classifiers votes sum for image.
  */
-bool ForcefulClassifier::classifyImage(float *image, int image_width, int x, int y, float temp1, float temp2) {
+float ForcefulClassifier::calculateScore(float *image, int image_width, int x, int y, float temp1, float temp2) {
   float counter = 0;
   int weights_index = 0;
   std::vector<WeaklyClassifier*>::iterator iterator;
   for (iterator = this->weakly_classifiers.begin(); iterator != this->weakly_classifiers.end(); iterator++) {
     counter += this->weights[weights_index++] * (*iterator)->classifyImage(image, image_width, x, y, temp1, temp2);
   }
-  return counter >= this->limit;
+  return counter;
+}
+
+/**
+ * Classify image by classifier.
+ */
+bool ForcefulClassifier::classifyImage(float *image, int image_width, int x, int y, float temp1, float temp2) {
+  return this->calculateScore(image, image_width, x, y, temp1, temp2) >= this->limit;
+}
+
+/**
+ * Classify image by soft cascade stage, score is carried from previous stages.
+ */
+bool ForcefulClassifier::classifyImage(float *image, int image_width, int x, int y, float temp1, float temp2, float &score) {
+  for (unsigned int i = 0; i < this->weakly_classifiers.size(); i++) {
+    score += this->weights[i] * this->weakly_classifiers[i]->classifyImage(image, image_width, x, y, temp1, temp2);
+    if (i < this->rejections.size() && score < this->rejections[i]) {
+      return false;
+    }
+  }
+  return score >= this->limit;
 }
 
 /**
@@ -142,10 +286,16 @@ bool ForcefulClassifier::classifyImage(float *image, int image_width, int x, int
  */
 std::string ForcefulClassifier::toString() {
   std::vector<WeaklyClassifier*>::iterator iterator;
-  std::string result = std::to_string(this->weakly_classifiers.size()) + " " + std::to_string(this->limit) + "\n";
+  std::string result = std::to_string(this->weakly_classifiers.size()) + " " + float_to_string(this->limit) + "\n";
   int weights_index = 0;
   for (iterator = this->weakly_classifiers.begin(); iterator != this->weakly_classifiers.end(); iterator++) {
-    result += std::to_string(this->weights[weights_index++]) + " " + (*iterator)->toString() + "\n";
+    result += float_to_string(this->weights[weights_index]) + " " + (*iterator)->toString();
+    // Soft cascade rejection limit ends weakly classifier line.
+    if (!this->rejections.empty()) {
+      result += " " + float_to_string(this->rejections[weights_index]);
+    }
+    result += "\n";
+    weights_index++;
   }
   return result;
 }
@@ -16,6 +16,10 @@ limitations under the License.
 
 /**
  * Forceful cascade classifier class.
+ *
+ * In soft cascade score is carried from previous stages and window is
+ * rejected, when score after any weakly classifier is below its rejection
+ * limit.
  */
 class ForcefulClassifier {
   public:
@@ -23,8 +27,22 @@ class ForcefulClassifier {
     ForcefulClassifier();
     ForcefulClassifier(std::vector<WeaklyClassifier*> weakly_classifiers, float *weights);
     ForcefulClassifier(std::vector<WeaklyClassifier*> weakly_classifiers, float *weights, float limit);
+    // Create deep classifier copy.
+    ForcefulClassifier* copy();
+    // Remove weakly classifiers from memory.
+    void destroyClassifiers();
     // Get weakly classifiers set.
     std::vector<WeaklyClassifier*> getWeaklyClassifiers();
+    // Get weakly classifiers count.
+    unsigned int weaklyCount();
+    // Get weakly classifiers weights.
+    std::vector<float> getWeights();
+    // Get classifier limit.
+    float getLimit();
+    // Get soft cascade rejection limits.
+    std::vector<float> getRejections();
+    // Set soft cascade rejection limits.
+    void setRejections(std::vector<float> rejections);
     // Scale weakly classifies by value.
     void scaleByValue(float value);
     // Scale limit by value.
@@ -33,10 +51,18 @@ class ForcefulClassifier {
     void addClassifier(WeaklyClassifier* weakly_classifier, float weight);
     // Calculate classifier limit.
     void calculateLimit(std::vector<float*> &positive_samples, int size, float maximum_fnr);
+    // Calculate soft cascade limit and rejection limits by positive samples scores after each weakly classifier.
+    void calculateRejections(std::vector<std::vector<float> > &positive_scores, float maximum_fnr);
     // Calculate classifier FPR.
     float calculateFpr(std::vector<float*> &negative_samples, int size);
+    // Calculate soft cascade FPR by negative samples scores after each weakly classifier.
+    float calculateFpr(std::vector<std::vector<float> > &negative_scores);
+    // Calculate weakly classifiers votes sum for image.
+    float calculateScore(float *image, int image_width, int x, int y, float temp1, float temp2);
     // Classify image by classifier.
     bool classifyImage(float *image, int image_width, int x, int y, float temp1, float temp2);
+    // Classify image by soft cascade stage, score is carried from previous stages.
+    bool classifyImage(float *image, int image_width, int x, int y, float temp1, float temp2, float &score);
     // Transform classifier to string representation.
     std::string toString();
   protected:
@@ -44,6 +70,9 @@ class ForcefulClassifier {
     float limit;
     // Classifier weights variable.
     std::vector<float> weights;
+    // Soft cascade score rejection limits after each weakly classifier,
+    // empty for usual cascade.
+    std::vector<float> rejections;
     // Weakly classifiers set.
     std::vector<WeaklyClassifier*> weakly_classifiers;
 };
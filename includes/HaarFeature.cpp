@@ -30,6 +30,13 @@ HaarFeature::HaarFeature(int feature_type, int x, int y, int w, int h) {
   this->h = h;
 }
 
+/**
+ * Create feature copy.
+ */
+HaarFeature* HaarFeature::copy() {
+  return new HaarFeature(this->feature_type, this->x, this->y, this->w, this->h);
+}
+
 /**
  * Get feature type.
  */
@@ -37,6 +44,20 @@ int HaarFeature::type() {
   return this->feature_type;
 }
 
+/**
+ * Get feature left coordinate.
+ */
+int HaarFeature::left() {
+  return this->x;
+}
+
+/**
+ * Get feature top coordinate.
+ */
+int HaarFeature::top() {
+  return this->y;
+}
+
 /**
  * Get feature width.
  */
@@ -21,8 +21,14 @@ class HaarFeature {
   public:
     // HaarFeature constructor method.
     HaarFeature(int feature_type, int x, int y, int w, int h);
+    // Create feature copy.
+    HaarFeature* copy();
     // Get feature type.
     int type();
+    // Get feature left coordinate.
+    int left();
+    // Get feature top coordinate.
+    int top();
     // Get feature width.
     int width();
     // Get feature height.
@@ -0,0 +1,206 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <phpcpp.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include "IntegralImages.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SIMPLE_IMAGE_X86_SIMD
+#endif
+
+/**
+ * Check, that CPU supports AVX.
+ */
+static bool detect_integral_images_avx() {
+#ifdef SIMPLE_IMAGE_X86_SIMD
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx");
+#else
+  return false;
+#endif
+}
+
+// AVX support of current CPU.
+static const bool integral_images_avx = detect_integral_images_avx();
+
+/**
+ * IntegralImages constructor.
+ *
+ * The first tables row is filled at once.
+ */
+IntegralImages::IntegralImages(unsigned int columns, float *integral_image, float *squared_integral_image) {
+  this->columns = columns;
+  this->rows_count = 0;
+  this->integral_image = integral_image;
+  this->squared_integral_image = squared_integral_image;
+  this->row_sum.assign(columns, 0);
+  this->squared_row_sum.assign(columns, 0);
+  this->column_sum.assign(columns, 0);
+  this->squared_column_sum.assign(columns, 0);
+  memset(integral_image, 0, (columns + 1) * sizeof(float));
+  memset(squared_integral_image, 0, (columns + 1) * sizeof(float));
+}
+
+/**
+ * Add next pixels rows.
+ */
+void IntegralImages::addRows(const float *pixels, unsigned int count) {
+  unsigned int padded_columns = this->columns + 1;
+  float *integral_row, *squared_integral_row;
+  double sum, squared_sum, pixel;
+
+  for (unsigned int y = 0; y < count; y++, pixels += this->columns) {
+    // Row prefix sums depend on previous pixel, so they are sequential.
+    sum = 0;
+    squared_sum = 0;
+    for (unsigned int x = 0; x < this->columns; x++) {
+      pixel = pixels[x];
+      sum += pixel;
+      squared_sum += pixel * pixel;
+      this->row_sum[x] = sum;
+      this->squared_row_sum[x] = squared_sum;
+    }
+    this->rows_count++;
+    integral_row = this->integral_image + (size_t) this->rows_count * padded_columns;
+    squared_integral_row = this->squared_integral_image + (size_t) this->rows_count * padded_columns;
+    integral_row[0] = 0;
+    squared_integral_row[0] = 0;
+    if (integral_images_avx) {
+      this->addColumnsAvx(integral_row + 1, squared_integral_row + 1);
+    }
+    else {
+      this->addColumnsScalar(integral_row + 1, squared_integral_row + 1);
+    }
+  }
+}
+
+/**
+ * Add next rows of 8 bit pixels, scaled to [0, 1] range.
+ *
+ * Pixels are converted row by row, so the whole image is never copied.
+ */
+void IntegralImages::addRows(const unsigned char *pixels, unsigned int count) {
+  this->row_pixels.resize(this->columns);
+  for (unsigned int y = 0; y < count; y++, pixels += this->columns) {
+    for (unsigned int x = 0; x < this->columns; x++) {
+      this->row_pixels[x] = pixels[x] / 255.0f;
+    }
+    this->addRows(this->row_pixels.data(), 1);
+  }
+}
+
+/**
+ * Get added rows count.
+ */
+unsigned int IntegralImages::rowsCount() {
+  return this->rows_count;
+}
+
+/**
+ * Allocate aligned table for image size, it is released by free().
+ */
+float* IntegralImages::allocate(unsigned int columns, unsigned int rows) {
+  void *table;
+  if (posix_memalign(&table, integral_images_alignment, (size_t) (columns + 1) * (rows + 1) * sizeof(float)) != 0) {
+    throw Php::Exception("Simple Image: Not enough memory for integral images");
+  }
+  return (float*) table;
+}
+
+/**
+ * Compute both tables of whole pixels array.
+ */
+void IntegralImages::compute(const float *pixels, unsigned int columns, unsigned int rows, float *integral_image, float *squared_integral_image) {
+  IntegralImages integral_images(columns, integral_image, squared_integral_image);
+  integral_images.addRows(pixels, rows);
+}
+
+/**
+ * Add row prefix sums to columns sums and store next tables rows.
+ */
+void IntegralImages::addColumnsScalar(float *integral_row, float *squared_integral_row) {
+  for (unsigned int x = 0; x < this->columns; x++) {
+    this->column_sum[x] += this->row_sum[x];
+    this->squared_column_sum[x] += this->squared_row_sum[x];
+    integral_row[x] = this->column_sum[x];
+    squared_integral_row[x] = this->squared_column_sum[x];
+  }
+}
+
+#ifdef SIMPLE_IMAGE_X86_SIMD
+
+/**
+ * Add row prefix sums to columns sums by AVX, four columns at once.
+ */
+__attribute__((target("avx")))
+void IntegralImages::addColumnsAvx(float *integral_row, float *squared_integral_row) {
+  double *column_sum = this->column_sum.data(), *squared_column_sum = this->squared_column_sum.data();
+  const double *row_sum = this->row_sum.data(), *squared_row_sum = this->squared_row_sum.data();
+  __m256d sum, squared_sum;
+  unsigned int x = 0;
+
+  for (; x + 4 <= this->columns; x += 4) {
+    sum = _mm256_add_pd(_mm256_loadu_pd(column_sum + x), _mm256_loadu_pd(row_sum + x));
+    squared_sum = _mm256_add_pd(_mm256_loadu_pd(squared_column_sum + x), _mm256_loadu_pd(squared_row_sum + x));
+    _mm256_storeu_pd(column_sum + x, sum);
+    _mm256_storeu_pd(squared_column_sum + x, squared_sum);
+    // Table rows are shifted by padding column, so stores are unaligned.
+    _mm_storeu_ps(integral_row + x, _mm256_cvtpd_ps(sum));
+    _mm_storeu_ps(squared_integral_row + x, _mm256_cvtpd_ps(squared_sum));
+  }
+  for (; x < this->columns; x++) {
+    column_sum[x] += row_sum[x];
+    squared_column_sum[x] += squared_row_sum[x];
+    integral_row[x] = column_sum[x];
+    squared_integral_row[x] = squared_column_sum[x];
+  }
+}
+
+#else
+
+/**
+ * Add row prefix sums to columns sums without AVX.
+ */
+void IntegralImages::addColumnsAvx(float *integral_row, float *squared_integral_row) {
+  this->addColumnsScalar(integral_row, squared_integral_row);
+}
+
+#endif
+
+/**
+ * IntegralTable constructor.
+ */
+IntegralTable::IntegralTable(unsigned int columns, unsigned int rows) {
+  this->table = IntegralImages::allocate(columns, rows);
+}
+
+/**
+ * IntegralTable destructor.
+ */
+IntegralTable::~IntegralTable() {
+  free(this->table);
+}
+
+/**
+ * Get table pointer.
+ */
+float* IntegralTable::data() {
+  return this->table;
+}
@@ -0,0 +1,83 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <vector>
+
+// Integral images memory alignment in bytes, one cache line.
+const size_t integral_images_alignment = 64;
+
+/**
+ * Fused builder of padded integral and squared integral images.
+ *
+ * Pixels are streamed row by row and both tables are filled in one pass.
+ * Row and column sums are accumulated in double, so large images do not
+ * lose precision, only stored values are rounded to float. Column sums
+ * have no dependency between columns, so they are added by AVX, when CPU
+ * supports it. Tables have (columns + 1) x (rows + 1) size with zero first
+ * row and column and are written in caller buffers.
+ */
+class IntegralImages {
+  public:
+    // Integral images builder constructor.
+    IntegralImages(unsigned int columns, float *integral_image, float *squared_integral_image);
+    // Add next pixels rows.
+    void addRows(const float *pixels, unsigned int count);
+    // Add next rows of 8 bit pixels, scaled to [0, 1] range.
+    void addRows(const unsigned char *pixels, unsigned int count);
+    // Get added rows count.
+    unsigned int rowsCount();
+    // Allocate aligned table for image size, it is released by free().
+    static float* allocate(unsigned int columns, unsigned int rows);
+    // Compute both tables of whole pixels array.
+    static void compute(const float *pixels, unsigned int columns, unsigned int rows, float *integral_image, float *squared_integral_image);
+  protected:
+    // Image columns count and added rows count.
+    unsigned int columns;
+    unsigned int rows_count;
+    // Output tables.
+    float *integral_image;
+    float *squared_integral_image;
+    // Current row of 8 bit pixels converted to float.
+    std::vector<float> row_pixels;
+    // Current row prefix sums and columns sums.
+    std::vector<double> row_sum;
+    std::vector<double> squared_row_sum;
+    std::vector<double> column_sum;
+    std::vector<double> squared_column_sum;
+    // Add row prefix sums to columns sums and store next tables rows.
+    void addColumnsScalar(float *integral_row, float *squared_integral_row);
+    void addColumnsAvx(float *integral_row, float *squared_integral_row);
+};
+
+/**
+ * Aligned integral image table of image size, released by destructor.
+ *
+ * Table is freed, when exception leaves the scope of its owner.
+ */
+class IntegralTable {
+  public:
+    // Integral table constructor and destructor.
+    IntegralTable(unsigned int columns, unsigned int rows);
+    ~IntegralTable();
+    // Get table pointer.
+    float* data();
+  protected:
+    // Table memory.
+    float *table;
+    // Table is owned by one object, so it is not copied.
+    IntegralTable(const IntegralTable &other);
+    IntegralTable& operator=(const IntegralTable &other);
+};
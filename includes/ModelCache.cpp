@@ -0,0 +1,106 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <phpcpp.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <vector>
+#include "HaarFeature.h"
+#include "WeaklyClassifier.h"
+#include "ForcefulClassifier.h"
+#include "CascadeClassifier.h"
+#include "CompiledCascade.h"
+#include "ModelCache.h"
+
+/**
+ * ModelCache constructor.
+ */
+ModelCache::ModelCache(model_cache_loader loader) {
+  this->loader = loader;
+  this->hits_count = 0;
+  this->misses_count = 0;
+}
+
+/**
+ * Get model from cache, load it on miss.
+ *
+ * Model is loaded without cache lock, so slow load does not block
+ * detection with other models.
+ */
+std::shared_ptr<CompiledCascade> ModelCache::get(std::string path) {
+  struct stat file_stat;
+  if (stat(path.c_str(), &file_stat) != 0) {
+    throw Php::Exception("Simple Image: Classifier file not exist");
+  }
+
+  model_cache_entry entry;
+  entry.device = file_stat.st_dev;
+  entry.inode = file_stat.st_ino;
+  entry.modified = file_stat.st_mtim.tv_sec;
+  entry.modified_nanoseconds = file_stat.st_mtim.tv_nsec;
+  entry.changed = file_stat.st_ctim.tv_sec;
+  entry.changed_nanoseconds = file_stat.st_ctim.tv_nsec;
+  entry.file_size = file_stat.st_size;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::map<std::string, model_cache_entry>::iterator iterator = this->entries.find(path);
+    if (iterator != this->entries.end() && iterator->second.device == entry.device && iterator->second.inode == entry.inode
+        && iterator->second.modified == entry.modified && iterator->second.modified_nanoseconds == entry.modified_nanoseconds
+        && iterator->second.changed == entry.changed && iterator->second.changed_nanoseconds == entry.changed_nanoseconds
+        && iterator->second.file_size == entry.file_size) {
+      this->hits_count++;
+      return iterator->second.model;
+    }
+    this->misses_count++;
+  }
+
+  entry.model = std::shared_ptr<CompiledCascade>(this->loader(path));
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->entries[path] = entry;
+  return entry.model;
+}
+
+/**
+ * Remove model from cache, get false if it was not cached.
+ */
+bool ModelCache::remove(std::string path) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->entries.erase(path) > 0;
+}
+
+/**
+ * Get cache hits count.
+ */
+unsigned long long ModelCache::hits() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->hits_count;
+}
+
+/**
+ * Get cache misses count.
+ */
+unsigned long long ModelCache::misses() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->misses_count;
+}
+
+/**
+ * Get cached models count.
+ */
+unsigned int ModelCache::size() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->entries.size();
+}
@@ -0,0 +1,70 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <functional>
+
+// Model loader type, receives model file path.
+typedef std::function<CompiledCascade*(std::string)> model_cache_loader;
+
+// Cached model structure, file identity is checked on every get.
+struct model_cache_entry {
+  unsigned long long device;
+  unsigned long long inode;
+  // Modification and status change times with nanoseconds, as rewrite
+  // in the same second keeps seconds.
+  long long modified;
+  long long modified_nanoseconds;
+  long long changed;
+  long long changed_nanoseconds;
+  long long file_size;
+  std::shared_ptr<CompiledCascade> model;
+};
+
+/**
+ * Per-process cache of compiled cascade models.
+ *
+ * Models are keyed by file path and reloaded, when file device, inode,
+ * modification or status change time or size are changed. Cached models
+ * are immutable and shared, so a model unloaded during detection stays
+ * alive until the detection ends.
+ */
+class ModelCache {
+  public:
+    // Model cache constructor.
+    ModelCache(model_cache_loader loader);
+    // Get model from cache, load it on miss.
+    std::shared_ptr<CompiledCascade> get(std::string path);
+    // Remove model from cache, get false if it was not cached.
+    bool remove(std::string path);
+    // Get cache hits count.
+    unsigned long long hits();
+    // Get cache misses count.
+    unsigned long long misses();
+    // Get cached models count.
+    unsigned int size();
+  protected:
+    // Models loader.
+    model_cache_loader loader;
+    // Cached models by path.
+    std::map<std::string, model_cache_entry> entries;
+    // Hits and misses counters.
+    unsigned long long hits_count, misses_count;
+    // Cache state guard.
+    std::mutex mutex;
+};
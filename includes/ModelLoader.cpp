@@ -0,0 +1,139 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <phpcpp.h>
+#include <string.h>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include "SimpleImageHelpers.h"
+#include "HaarFeature.h"
+#include "WeaklyClassifier.h"
+#include "ForcefulClassifier.h"
+#include "CascadeClassifier.h"
+#include "CompiledCascade.h"
+#include "ModelLoader.h"
+
+/**
+ * Load cascade classifier from text file.
+ */
+CascadeClassifier* load_cascade_classifier_from_file(std::string file_name) {
+  if (!file_is_exist(file_name)) {
+    throw Php::Exception("Simple Image: Classifier file not exist");
+  }
+
+  std::ifstream file(file_name);
+  HaarFeature *feature;
+  std::vector<WeaklyClassifier*> *weakly_classifiers;
+  std::vector<ForcefulClassifier*> forceful_classifiers;
+  WeaklyClassifier *weakly_classifier;
+  ForcefulClassifier *forceful_classifier;
+  unsigned int forceful_count, weakly_count, bins_count;
+  int size, feature_type, x, y, w, h, state, index, soft = 0;
+  float forceful_limit, weakly_limit, bin_width, *weights;
+  std::vector<float> table, rejections;
+  std::string header_line;
+
+  // Header line has optional soft cascade flag after stages count.
+  std::getline(file, header_line);
+  std::istringstream header(header_line);
+  header >> size >> forceful_count;
+  if (!(header >> soft)) {
+    soft = 0;
+  }
+  while (forceful_classifiers.size() < forceful_count) {
+    file >> weakly_count >> forceful_limit;
+    weights = new float[weakly_count];
+    weakly_classifiers = new std::vector<WeaklyClassifier*>();
+    rejections.resize(weakly_count);
+    index = 0;
+    while (weakly_classifiers->size() < weakly_count) {
+      file >> weights[index++] >> feature_type >> w >> h >> x >> y >> weakly_limit >> state;
+      feature = new HaarFeature(feature_type, x, y, w, h);
+      if (state == 2) {
+        // Lookup table classifier.
+        file >> bin_width >> bins_count;
+        if (!file || bins_count == 0 || !(bin_width > 0)) {
+          throw Php::Exception("Simple Image: Wrong classifier format");
+        }
+        table.resize(bins_count);
+        for (unsigned int i = 0; i < bins_count; i++) {
+          file >> table[i];
+        }
+        weakly_classifier = new WeaklyClassifier(feature, weakly_limit, bin_width, table);
+      }
+      else {
+        weakly_classifier = new WeaklyClassifier(feature, weakly_limit, (bool) state);
+      }
+      if (soft) {
+        file >> rejections[index - 1];
+      }
+      weakly_classifiers->push_back(weakly_classifier);
+    }
+    forceful_classifier = new ForcefulClassifier(*weakly_classifiers, weights, forceful_limit);
+    if (soft) {
+      forceful_classifier->setRejections(rejections);
+    }
+    forceful_classifiers.push_back(forceful_classifier);
+  }
+
+  if (forceful_classifiers.empty() || size < sample_min_size || size > sample_max_size) {
+    throw Php::Exception("Simple Image: Wrong classifier format");
+  }
+  CascadeClassifier *cascade_classifier = new CascadeClassifier(forceful_classifiers, size);
+  cascade_classifier->setSoft(soft != 0);
+  return cascade_classifier;
+}
+
+/**
+ * Destroy cascade classifier loaded from text file with all its parts.
+ */
+void destroy_cascade_classifier(CascadeClassifier *cascade_classifier) {
+  std::vector<ForcefulClassifier*> forceful_classifiers = cascade_classifier->getForcefulClassifiers();
+  std::vector<WeaklyClassifier*> weakly_classifiers;
+  for (unsigned int i = 0; i < forceful_classifiers.size(); i++) {
+    weakly_classifiers = forceful_classifiers[i]->getWeaklyClassifiers();
+    for (unsigned int j = 0; j < weakly_classifiers.size(); j++) {
+      delete weakly_classifiers[j]->getFeature();
+    }
+  }
+  cascade_classifier->destroyClassifiers();
+  delete cascade_classifier;
+}
+
+/**
+ * Load compiled cascade classifier from binary or text file.
+ */
+CompiledCascade* load_compiled_cascade_from_file(std::string file_name) {
+  if (!file_is_exist(file_name)) {
+    throw Php::Exception("Simple Image: Classifier file not exist");
+  }
+
+  CompiledCascade *compiled_cascade;
+  if (CompiledCascade::isBinaryFile(file_name)) {
+    compiled_cascade = new CompiledCascade(file_name);
+    if (compiled_cascade->getSize() < sample_min_size || compiled_cascade->getSize() > sample_max_size) {
+      delete compiled_cascade;
+      throw Php::Exception("Simple Image: Wrong classifier format");
+    }
+  }
+  else {
+    CascadeClassifier *cascade_classifier = load_cascade_classifier_from_file(file_name);
+    compiled_cascade = new CompiledCascade(cascade_classifier);
+    destroy_cascade_classifier(cascade_classifier);
+  }
+  return compiled_cascade;
+}
@@ -0,0 +1,22 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Load cascade classifier from text file.
+CascadeClassifier* load_cascade_classifier_from_file(std::string file_name);
+// Destroy cascade classifier loaded from text file with all its parts.
+void destroy_cascade_classifier(CascadeClassifier *cascade_classifier);
+// Load compiled cascade classifier from binary or text file.
+CompiledCascade* load_compiled_cascade_from_file(std::string file_name);
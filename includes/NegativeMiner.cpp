@@ -0,0 +1,266 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <phpcpp.h>
+#include <string.h>
+#include <vector>
+#include <deque>
+#include <map>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+#include "SimpleImageHelpers.h"
+#include "HaarFeature.h"
+#include "WeaklyClassifier.h"
+#include "ForcefulClassifier.h"
+#include "CascadeClassifier.h"
+#include "ThreadPool.h"
+#include "SampleStore.h"
+#include "SamplePool.h"
+#include "NegativeMiner.h"
+
+/**
+ * NegativeMiner constructor.
+ */
+NegativeMiner::NegativeMiner(SampleReader *reader, int size, bool normalize, bool rotation, ThreadPool *thread_pool) {
+  this->reader = reader;
+  this->size = size;
+  this->normalize = normalize;
+  this->rotation = rotation;
+  this->thread_pool = thread_pool;
+  // Every worker computes integral images in own buffer.
+  this->buffers.resize(thread_pool->size(), std::vector<float>((size_t) (size + 1) * (size + 1)));
+  // Enough chunks to keep every worker busy, while the oldest one is committed.
+  this->chunks_capacity = 2 * thread_pool->size() + 2;
+}
+
+/**
+ * Fill pool by samples, which pass cascade, up to count.
+ *
+ * Pool is not changed, when it already has count samples or samples file
+ * is over.
+ */
+void NegativeMiner::mine(CascadeClassifier *cascade_classifier, SamplePool &pool, unsigned int count) {
+  if (pool.size() >= count) {
+    return;
+  }
+  this->cascade_classifier = cascade_classifier;
+  this->pool = &pool;
+  this->count = count;
+  this->next_read = this->next_commit = 0;
+  this->position = this->reader->position();
+  this->reading = true;
+  this->stopped = false;
+  this->reader_error = nullptr;
+
+  std::thread reader_thread(&NegativeMiner::read, this);
+  std::exception_ptr error;
+  try {
+    this->thread_pool->run(this->thread_pool->size(), [this](unsigned int worker_index, unsigned int task_index) {
+      this->work(worker_index);
+    });
+  }
+  catch (...) {
+    error = std::current_exception();
+    this->stop();
+  }
+  reader_thread.join();
+  // Remove chunks, which were not used.
+  for (unsigned int i = 0; i < this->queue.size(); i++) {
+    delete this->queue[i];
+  }
+  this->queue.clear();
+  for (auto &iterator : this->processed) {
+    delete iterator.second;
+  }
+  this->processed.clear();
+  if (!error) {
+    error = this->reader_error;
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  // Next mining continues after the last used sample.
+  this->reader->seek(this->position);
+}
+
+/**
+ * Read chunks until file is over or mining is stopped.
+ */
+void NegativeMiner::read() {
+  int sample_size = this->size * this->size;
+  try {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->space.wait(lock, [this] {
+          return this->stopped || this->next_read - this->next_commit < this->chunks_capacity;
+        });
+        if (this->stopped) {
+          break;
+        }
+      }
+      negative_chunk *chunk = new negative_chunk();
+      chunk->pixels.resize((size_t) negative_chunk_samples * sample_size);
+      chunk->positions.reserve(negative_chunk_samples);
+      chunk->count = 0;
+      while (chunk->count < negative_chunk_samples && this->reader->read(chunk->pixels.data() + (size_t) chunk->count * sample_size)) {
+        chunk->positions.push_back(this->reader->position());
+        chunk->count++;
+      }
+      if (chunk->count == 0) {
+        delete chunk;
+        break;
+      }
+      bool over = chunk->count < negative_chunk_samples;
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        chunk->index = this->next_read++;
+        this->queue.push_back(chunk);
+      }
+      this->ready.notify_one();
+      if (over) {
+        break;
+      }
+    }
+  }
+  catch (...) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->reader_error = std::current_exception();
+  }
+  if (this->reader_error) {
+    this->stop();
+  }
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->reading = false;
+  this->ready.notify_all();
+}
+
+/**
+ * Process chunks until they are over.
+ */
+void NegativeMiner::work(unsigned int worker_index) {
+  try {
+    while (true) {
+      negative_chunk *chunk;
+      {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->ready.wait(lock, [this] {
+          return this->stopped || !this->queue.empty() || !this->reading;
+        });
+        if (this->stopped || this->queue.empty()) {
+          return;
+        }
+        chunk = this->queue.front();
+        this->queue.pop_front();
+      }
+      this->process(chunk, worker_index);
+      this->commit(chunk);
+    }
+  }
+  catch (...) {
+    this->stop();
+    throw;
+  }
+}
+
+/**
+ * Find samples of chunk, which pass cascade.
+ *
+ * Samples are normalized and rotated in chunk pixels, rotated samples go
+ * after sample, as in sequential mining.
+ */
+void NegativeMiner::process(negative_chunk *chunk, unsigned int worker_index) {
+  int sample_size = this->size * this->size;
+  size_t integral_size = (size_t) (this->size + 1) * (this->size + 1);
+  float *integral_image = this->buffers[worker_index].data();
+  float *sample, *rotated_sample;
+  int rotations_count = this->rotation ? 4 : 1;
+  for (unsigned int i = 0; i < chunk->count; i++) {
+    sample = chunk->pixels.data() + (size_t) i * sample_size;
+    if (this->normalize) {
+      normalize_sample(sample, this->size, this->size);
+    }
+    for (int rotation_index = 0; rotation_index < rotations_count; rotation_index++) {
+      compute_padded_integral_image(sample, this->size, this->size, false, integral_image);
+      if (this->cascade_classifier->classifyImage(integral_image, this->size + 1, 1, 1, 0, 1)) {
+        chunk->accepted.insert(chunk->accepted.end(), integral_image, integral_image + integral_size);
+        chunk->sources.push_back(i);
+      }
+      if (rotation_index < rotations_count - 1) {
+        rotated_sample = sample_rotate_90(sample, this->size, this->size);
+        memcpy(sample, rotated_sample, sample_size * sizeof(float));
+        delete[] rotated_sample;
+      }
+    }
+  }
+}
+
+/**
+ * Put processed chunks in pool in reading order.
+ *
+ * Chunk waits for commit, until all previous chunks are committed. When
+ * pool is full, mining is stopped and reading position is kept right after
+ * sample of the last added integral image.
+ */
+void NegativeMiner::commit(negative_chunk *chunk) {
+  size_t integral_size = (size_t) (this->size + 1) * (this->size + 1);
+  std::unique_lock<std::mutex> lock(this->mutex);
+  if (this->stopped) {
+    delete chunk;
+    return;
+  }
+  this->processed[chunk->index] = chunk;
+  std::map<unsigned long, negative_chunk*>::iterator iterator;
+  while (!this->stopped && (iterator = this->processed.find(this->next_commit)) != this->processed.end()) {
+    chunk = iterator->second;
+    this->processed.erase(iterator);
+    for (unsigned int i = 0; i < chunk->sources.size() && !this->stopped; i++) {
+      this->pool->addIntegralImage(chunk->accepted.data() + i * integral_size);
+      if (this->pool->size() >= this->count) {
+        this->position = chunk->positions[chunk->sources[i]];
+        this->stopped = true;
+      }
+    }
+    if (!this->stopped) {
+      this->position = chunk->positions.back();
+    }
+    delete chunk;
+    this->next_commit++;
+  }
+  bool stopped = this->stopped;
+  lock.unlock();
+  if (stopped) {
+    this->ready.notify_all();
+  }
+  this->space.notify_all();
+}
+
+/**
+ * Stop mining and wake all threads.
+ */
+void NegativeMiner::stop() {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stopped = true;
+  }
+  this->ready.notify_all();
+  this->space.notify_all();
+}
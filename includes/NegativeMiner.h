@@ -0,0 +1,91 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+// Samples count read from negative file at once.
+const unsigned int negative_chunk_samples = 256;
+
+// Negative samples chunk structure, passed from reader to miners.
+struct negative_chunk {
+  unsigned long index;
+  unsigned int count;
+  // Raw samples pixels and reading position after every sample.
+  std::vector<float> pixels;
+  std::vector<unsigned long long> positions;
+  // Integral images of samples, which pass cascade, and their source samples.
+  std::vector<float> accepted;
+  std::vector<unsigned int> sources;
+};
+
+/**
+ * Hard negative samples miner.
+ *
+ * Reader thread parses negative samples file by chunks, workers of thread
+ * pool normalize samples, rotate them, if needed, compute integral images
+ * and keep samples, which pass the current cascade. Chunks are committed
+ * to the pool in reading order, so the pool gets the same samples as with
+ * sequential mining. Read, but not committed chunks are bounded, reader
+ * waits, when miners are behind. After mining the file reader is moved
+ * right after the last sample, which was used.
+ */
+class NegativeMiner {
+  public:
+    // Negative miner constructor.
+    NegativeMiner(SampleReader *reader, int size, bool normalize, bool rotation, ThreadPool *thread_pool);
+    // Fill pool by samples, which pass cascade, up to count.
+    void mine(CascadeClassifier *cascade_classifier, SamplePool &pool, unsigned int count);
+  protected:
+    // Mining params.
+    SampleReader *reader;
+    int size;
+    bool normalize, rotation;
+    ThreadPool *thread_pool;
+    // Per-worker sample and integral image buffers.
+    std::vector<std::vector<float> > buffers;
+    // Current mining state.
+    CascadeClassifier *cascade_classifier;
+    SamplePool *pool;
+    unsigned int count;
+    // Read chunks queue, processed chunks waiting for commit, guard and notifications.
+    std::deque<negative_chunk*> queue;
+    std::map<unsigned long, negative_chunk*> processed;
+    unsigned int chunks_capacity;
+    std::mutex mutex;
+    std::condition_variable ready, space;
+    // Next chunk indexes to read and to commit.
+    unsigned long next_read, next_commit;
+    // Reading position after the last committed sample.
+    unsigned long long position;
+    bool reading, stopped;
+    std::exception_ptr reader_error;
+    // Read chunks until file is over or mining is stopped.
+    void read();
+    // Process chunks until they are over.
+    void work(unsigned int worker_index);
+    // Find samples of chunk, which pass cascade.
+    void process(negative_chunk *chunk, unsigned int worker_index);
+    // Put processed chunks in pool in reading order.
+    void commit(negative_chunk *chunk);
+    // Stop mining and wake all threads.
+    void stop();
+};
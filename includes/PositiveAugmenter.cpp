@@ -0,0 +1,100 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <phpcpp.h>
+#include <vector>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include "SimpleImageHelpers.h"
+#include "HaarFeature.h"
+#include "WeaklyClassifier.h"
+#include "ForcefulClassifier.h"
+#include "CascadeClassifier.h"
+#include "ThreadPool.h"
+#include "SamplePool.h"
+#include "SampleAugmentation.h"
+#include "PositiveAugmenter.h"
+
+/**
+ * PositiveAugmenter constructor.
+ *
+ * Base samples are given as pixels shades one after another, vector is
+ * taken by augmenter.
+ */
+PositiveAugmenter::PositiveAugmenter(std::vector<float> &base_samples, int size, const augmentation_spec &spec, bool normalize, ThreadPool *thread_pool) {
+  this->base_samples.swap(base_samples);
+  this->size = size;
+  this->spec = spec;
+  this->normalize = normalize;
+  this->thread_pool = thread_pool;
+  this->integral_images.resize((size_t) positive_augmentation_batch * (size + 1) * (size + 1));
+  this->passed.resize(positive_augmentation_batch);
+}
+
+/**
+ * Get base samples count.
+ */
+unsigned int PositiveAugmenter::baseCount() {
+  return this->base_samples.size() / (this->size * this->size);
+}
+
+/**
+ * Fill pool by variants of step, which pass cascade.
+ *
+ * Pool is cleared and gets spec count variants, less when too many
+ * variants are rejected by cascade.
+ */
+void PositiveAugmenter::fill(CascadeClassifier *cascade_classifier, SamplePool &pool, unsigned int step) {
+  unsigned int sample_size = this->size * this->size, integral_size = (this->size + 1) * (this->size + 1);
+  unsigned int base_count = this->baseCount(), batch_count, groups_count;
+  unsigned long long attempts = (unsigned long long) this->spec.count * positive_augmentation_attempts;
+  pool.clear();
+  if (base_count == 0) {
+    return;
+  }
+  for (unsigned long long first = 0; pool.size() < this->spec.count && first < attempts; first += positive_augmentation_batch) {
+    batch_count = attempts - first < positive_augmentation_batch ? attempts - first : positive_augmentation_batch;
+    groups_count = (batch_count + positive_augmentation_group - 1) / positive_augmentation_group;
+    this->thread_pool->run(groups_count, [&](unsigned int worker_index, unsigned int group_index) {
+      unsigned int begin = group_index * positive_augmentation_group;
+      unsigned int end = begin + positive_augmentation_group < batch_count ? begin + positive_augmentation_group : batch_count;
+      unsigned long long group = (first + begin) / positive_augmentation_group;
+      std::seed_seq sequence{(unsigned int) this->spec.seed, (unsigned int) (this->spec.seed >> 32), step, (unsigned int) group, (unsigned int) (group >> 32)};
+      std::mt19937 generator(sequence);
+      std::uniform_int_distribution<unsigned int> base_distribution(0, base_count - 1);
+      std::vector<float> sample(sample_size), buffer(sample_size);
+      float *integral_image;
+      for (unsigned int i = begin; i < end; i++) {
+        augment_sample(this->base_samples.data() + (size_t) base_distribution(generator) * sample_size, this->size, this->spec, generator, sample.data(), buffer.data());
+        if (this->normalize) {
+          normalize_sample(sample.data(), this->size, this->size);
+        }
+        integral_image = this->integral_images.data() + (size_t) i * integral_size;
+        compute_padded_integral_image(sample.data(), this->size, this->size, false, integral_image);
+        this->passed[i] = cascade_classifier->classifyImage(integral_image, this->size + 1, 1, 1, 0, 1);
+      }
+    });
+    for (unsigned int i = 0; i < batch_count && pool.size() < this->spec.count; i++) {
+      if (this->passed[i]) {
+        pool.addIntegralImage(this->integral_images.data() + (size_t) i * integral_size);
+      }
+    }
+  }
+}
@@ -0,0 +1,54 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <vector>
+
+// Variants count made between commits to pool.
+const unsigned int positive_augmentation_batch = 1024;
+// Samples count made by one random generator, batch is divided by it.
+const unsigned int positive_augmentation_group = 64;
+// Maximum made variants per pool sample, when variants do not pass cascade.
+const unsigned int positive_augmentation_attempts = 20;
+
+/**
+ * Positive samples augmenter of cascade training.
+ *
+ * Base samples are kept once and every training step gets new pool of
+ * random variants, which pass the current cascade, so memory does not
+ * grow with effective positives count. Variants are made by batches in
+ * thread pool into a reused buffer and committed in order, every group of
+ * variants has own random generator seeded by spec seed, step and group
+ * index, so training does not depend on threads count.
+ */
+class PositiveAugmenter {
+  public:
+    // Positive augmenter constructor.
+    PositiveAugmenter(std::vector<float> &base_samples, int size, const augmentation_spec &spec, bool normalize, ThreadPool *thread_pool);
+    // Get base samples count.
+    unsigned int baseCount();
+    // Fill pool by variants of step, which pass cascade.
+    void fill(CascadeClassifier *cascade_classifier, SamplePool &pool, unsigned int step);
+  protected:
+    // Base samples pixels shades.
+    std::vector<float> base_samples;
+    int size;
+    augmentation_spec spec;
+    bool normalize;
+    ThreadPool *thread_pool;
+    // Batch integral images and their cascade results.
+    std::vector<float> integral_images;
+    std::vector<char> passed;
+};
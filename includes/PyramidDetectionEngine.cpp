@@ -0,0 +1,146 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <phpcpp.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include "SimpleImageHelpers.h"
+#include "HaarFeature.h"
+#include "WeaklyClassifier.h"
+#include "ForcefulClassifier.h"
+#include "CascadeClassifier.h"
+#include "CompiledCascade.h"
+#include "ScaledCascade.h"
+#include "ThreadPool.h"
+#include "IntegralImages.h"
+#include "DetectionEngine.h"
+#include "PyramidDetectionEngine.h"
+
+// Approximate windows count per pyramid detection task.
+const unsigned int pyramid_windows_per_task = 4096;
+
+/**
+ * PyramidDetectionEngine constructor.
+ *
+ * Level sizes are rounded down, so level windows never leave source image.
+ */
+PyramidDetectionEngine::PyramidDetectionEngine(CompiledCascade *compiled_cascade, unsigned int columns, unsigned int rows, float scale_step, float slide_step, float scale_value) {
+  unsigned int size = compiled_cascade->getSize();
+  pyramid_level level;
+
+  this->columns = columns;
+  this->rows = rows;
+  this->slide = size * slide_step;
+  if (this->slide < 1) {
+    this->slide = 1;
+  }
+  for (unsigned int i = 0; ; i++) {
+    level.scale = pow(scale_step, i);
+    level.columns = columns / level.scale;
+    level.rows = rows / level.scale;
+    if (level.columns < size || level.rows < size) {
+      break;
+    }
+    level.scaled_cascade = new ScaledCascade(compiled_cascade, 0, scale_step, scale_value, level.columns + 1);
+    level.integral_image = NULL;
+    level.squared_integral_image = NULL;
+    this->levels.push_back(level);
+  }
+
+  // Split windows rows of each level in bands of similar windows count.
+  detection_task task;
+  unsigned int windows_columns, windows_rows, band_rows;
+  for (unsigned int i = 0; i < this->levels.size(); i++) {
+    windows_columns = (this->levels[i].columns - size) / this->slide + 1;
+    windows_rows = (this->levels[i].rows - size) / this->slide + 1;
+    band_rows = pyramid_windows_per_task / windows_columns;
+    if (band_rows < 1) {
+      band_rows = 1;
+    }
+    task.scale_index = i;
+    for (unsigned int row = 0; row < windows_rows; row += band_rows) {
+      task.first_row = row;
+      task.last_row = row + band_rows < windows_rows ? row + band_rows : windows_rows;
+      this->tasks.push_back(task);
+    }
+  }
+}
+
+/**
+ * PyramidDetectionEngine destructor.
+ */
+PyramidDetectionEngine::~PyramidDetectionEngine() {
+  for (unsigned int i = 0; i < this->levels.size(); i++) {
+    delete this->levels[i].scaled_cascade;
+    free(this->levels[i].integral_image);
+    free(this->levels[i].squared_integral_image);
+  }
+}
+
+/**
+ * Get pyramid levels count.
+ */
+unsigned int PyramidDetectionEngine::levelsCount() {
+  return this->levels.size();
+}
+
+/**
+ * Detect objects on source pixels shade and put them in detection manager.
+ *
+ * Pixels are given row by row.
+ */
+void PyramidDetectionEngine::detect(const float *pixels, ThreadPool *thread_pool, DetectionManager *detection_manager) {
+  thread_pool->run(this->levels.size(), [&](unsigned int worker_index, unsigned int level_index) {
+    this->buildLevel(this->levels[level_index], pixels);
+  });
+
+  std::vector<std::vector<detection_structure> > detections(this->tasks.size());
+  thread_pool->run(this->tasks.size(), [&](unsigned int worker_index, unsigned int task_index) {
+    pyramid_level &level = this->levels[this->tasks[task_index].scale_index];
+    detect_windows_rows(level.scaled_cascade, level.integral_image, level.squared_integral_image, level.columns, this->slide, this->tasks[task_index].first_row, this->tasks[task_index].last_row, detections[task_index]);
+  });
+
+  // Merge detections in tasks order, so result does not depend on threads.
+  pyramid_level *level;
+  for (unsigned int i = 0; i < detections.size(); i++) {
+    level = &this->levels[this->tasks[i].scale_index];
+    for (unsigned int j = 0; j < detections[i].size(); j++) {
+      detection_manager->addDetection(detections[i][j].x * level->scale + 0.5f, detections[i][j].y * level->scale + 0.5f, detections[i][j].size * level->scale + 0.5f, detections[i][j].margin);
+    }
+  }
+}
+
+/**
+ * Build integral images of one level.
+ *
+ * Level tables are allocated once and kept by engine, so engine can be
+ * reused for next images of the same size.
+ */
+void PyramidDetectionEngine::buildLevel(pyramid_level &level, const float *pixels) {
+  if (level.integral_image == NULL) {
+    level.integral_image = IntegralImages::allocate(level.columns, level.rows);
+    level.squared_integral_image = IntegralImages::allocate(level.columns, level.rows);
+  }
+  if (level.columns == this->columns && level.rows == this->rows) {
+    IntegralImages::compute(pixels, level.columns, level.rows, level.integral_image, level.squared_integral_image);
+    return;
+  }
+  std::vector<float> level_pixels(level.columns * level.rows);
+  downsample_pixels(pixels, this->columns, this->rows, level.scale, level_pixels.data(), level.columns, level.rows);
+  IntegralImages::compute(level_pixels.data(), level.columns, level.rows, level.integral_image, level.squared_integral_image);
+}
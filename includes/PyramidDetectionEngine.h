@@ -0,0 +1,61 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Image pyramid level structure.
+struct pyramid_level {
+  // Level scale relative to source image.
+  float scale;
+  // Level image sizes.
+  unsigned int columns;
+  unsigned int rows;
+  // Base size cascade linked to level integral images stride.
+  ScaledCascade *scaled_cascade;
+  // Level integral images with zero first row and column.
+  float *integral_image;
+  float *squared_integral_image;
+};
+
+/**
+ * Image pyramid detection engine.
+ *
+ * Source image is downsampled by scale step with area averaging, every
+ * level has own integral images and is scanned by the base size cascade,
+ * so features keep their trained coordinates and large objects are found
+ * on small images. Levels are built in parallel, each from source pixels,
+ * and then windows rows bands of all levels are classified in parallel.
+ * Detections are given in source image coordinates.
+ */
+class PyramidDetectionEngine {
+  public:
+    // Pyramid detection engine constructor and destructor.
+    PyramidDetectionEngine(CompiledCascade *compiled_cascade, unsigned int columns, unsigned int rows, float scale_step, float slide_step, float scale_value);
+    ~PyramidDetectionEngine();
+    // Get pyramid levels count.
+    unsigned int levelsCount();
+    // Detect objects on source pixels shade and put them in detection manager.
+    void detect(const float *pixels, ThreadPool *thread_pool, DetectionManager *detection_manager);
+  protected:
+    // Source image sizes.
+    unsigned int columns, rows;
+    // Windows slide on every level.
+    unsigned int slide;
+    // Pyramid levels set.
+    std::vector<pyramid_level> levels;
+    // Detection tasks set.
+    std::vector<detection_task> tasks;
+    // Build integral images of one level.
+    void buildLevel(pyramid_level &level, const float *pixels);
+};
@@ -0,0 +1,237 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <math.h>
+#include <vector>
+#include <random>
+#include "SampleAugmentation.h"
+
+// Poisson noise mean, above which normal approximation is used.
+const float augmentation_poisson_limit = 1000;
+
+/**
+ * Rotate, scale and shift sample around its center with bilinear resampling.
+ *
+ * Angle is given in degrees, shift in pixels. Every result pixel takes
+ * source point by inverse transform, points outside sample take the
+ * nearest border pixels.
+ */
+void augment_affine(const float *sample, int w, int h, float angle, float scale, float shift_x, float shift_y, float *result) {
+  float radians = angle * M_PI / 180, cosine = cos(radians) / scale, sine = sin(radians) / scale;
+  float center_x = (w - 1) / 2.0f, center_y = (h - 1) / 2.0f;
+  float dx, dy, source_x, source_y, fx, fy;
+  int x0, y0, x1, y1;
+  for (int y = 0; y < h; y++) {
+    dy = y - center_y - shift_y;
+    for (int x = 0; x < w; x++) {
+      dx = x - center_x - shift_x;
+      source_x = cosine * dx + sine * dy + center_x;
+      source_y = -sine * dx + cosine * dy + center_y;
+      source_x = source_x < 0 ? 0 : (source_x > w - 1 ? w - 1 : source_x);
+      source_y = source_y < 0 ? 0 : (source_y > h - 1 ? h - 1 : source_y);
+      x0 = source_x;
+      y0 = source_y;
+      x1 = x0 + 1 < w ? x0 + 1 : x0;
+      y1 = y0 + 1 < h ? y0 + 1 : y0;
+      fx = source_x - x0;
+      fy = source_y - y0;
+      result[y * w + x] = (sample[y0 * w + x0] * (1 - fx) + sample[y0 * w + x1] * fx) * (1 - fy) + (sample[y1 * w + x0] * (1 - fx) + sample[y1 * w + x1] * fx) * fy;
+    }
+  }
+}
+
+/**
+ * Blur sample by separable kernel, borders are clamped.
+ *
+ * Kernel has odd length with center in the middle.
+ */
+static void augment_separable_blur(float *sample, int w, int h, const std::vector<float> &kernel, float *buffer) {
+  int radius = kernel.size() / 2, k;
+  float value;
+  // Rows pass from sample to buffer.
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      value = 0;
+      for (int i = -radius; i <= radius; i++) {
+        k = x + i < 0 ? 0 : (x + i >= w ? w - 1 : x + i);
+        value += sample[y * w + k] * kernel[i + radius];
+      }
+      buffer[y * w + x] = value;
+    }
+  }
+  // Columns pass from buffer back to sample.
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      value = 0;
+      for (int i = -radius; i <= radius; i++) {
+        k = y + i < 0 ? 0 : (y + i >= h ? h - 1 : y + i);
+        value += buffer[k * w + x] * kernel[i + radius];
+      }
+      sample[y * w + x] = value;
+    }
+  }
+}
+
+/**
+ * Blur sample by box of radius, buffer has sample size.
+ */
+void augment_box_blur(float *sample, int w, int h, int radius, float *buffer) {
+  if (radius < 1) {
+    return;
+  }
+  std::vector<float> kernel(2 * radius + 1, 1.0f / (2 * radius + 1));
+  augment_separable_blur(sample, w, h, kernel, buffer);
+}
+
+/**
+ * Blur sample by Gaussian kernel, buffer has sample size.
+ *
+ * Kernel is cut at three sigmas and normalized.
+ */
+void augment_gaussian_blur(float *sample, int w, int h, float sigma, float *buffer) {
+  int radius = ceil(3 * sigma);
+  if (sigma <= 0 || radius < 1) {
+    return;
+  }
+  std::vector<float> kernel(2 * radius + 1);
+  float sum = 0;
+  for (int i = -radius; i <= radius; i++) {
+    kernel[i + radius] = exp(-(i * i) / (2 * sigma * sigma));
+    sum += kernel[i + radius];
+  }
+  for (unsigned int i = 0; i < kernel.size(); i++) {
+    kernel[i] /= sum;
+  }
+  augment_separable_blur(sample, w, h, kernel, buffer);
+}
+
+/**
+ * Change sample brightness and contrast around middle shade.
+ */
+void augment_brightness_contrast(float *sample, int count, float brightness, float contrast) {
+  for (int i = 0; i < count; i++) {
+    sample[i] = (sample[i] - 0.5f) * contrast + 0.5f + brightness;
+  }
+}
+
+/**
+ * Add noise of model with amount to sample.
+ *
+ * Amount is noise deviation for additive and multiplicative models,
+ * share of changed pixels for impulse noise and relative deviation of
+ * middle shade for Poisson noise.
+ */
+void augment_noise(float *sample, int count, augmentation_noise noise, float amount, std::mt19937 &generator) {
+  if (amount <= 0) {
+    return;
+  }
+  std::uniform_real_distribution<float> uniform(0, 1);
+  std::normal_distribution<float> normal(0, amount);
+  float photons, value;
+  switch (noise) {
+    case augmentation_noise_uniform:
+      // Uniform noise with amount deviation.
+      for (int i = 0; i < count; i++) {
+        sample[i] += (uniform(generator) - 0.5f) * amount * sqrt(12.0f);
+      }
+      break;
+    case augmentation_noise_gaussian:
+      for (int i = 0; i < count; i++) {
+        sample[i] += normal(generator);
+      }
+      break;
+    case augmentation_noise_multiplicative_gaussian:
+      for (int i = 0; i < count; i++) {
+        sample[i] *= 1 + normal(generator);
+      }
+      break;
+    case augmentation_noise_impulse:
+      for (int i = 0; i < count; i++) {
+        if (uniform(generator) < amount) {
+          sample[i] = uniform(generator) < 0.5f ? 0 : 1;
+        }
+      }
+      break;
+    case augmentation_noise_laplacian:
+      // Laplacian noise by inverse distribution function.
+      for (int i = 0; i < count; i++) {
+        value = uniform(generator) - 0.5f;
+        sample[i] -= amount / sqrt(2.0f) * (value < 0 ? -1 : 1) * log(1 - 2 * fabs(value) + 1e-7f);
+      }
+      break;
+    case augmentation_noise_poisson:
+      // Shade 0.5 gets amount relative deviation. Large counts are taken
+      // from normal approximation, Poisson distribution is slow for them.
+      photons = 0.5f / (amount * amount * 0.25f);
+      for (int i = 0; i < count; i++) {
+        if (sample[i] <= 0) {
+          sample[i] = 0;
+          continue;
+        }
+        value = sample[i] * photons;
+        if (value > augmentation_poisson_limit) {
+          sample[i] += sqrt(sample[i] / photons) * normal(generator) / amount;
+        }
+        else {
+          std::poisson_distribution<int> poisson(value);
+          sample[i] = poisson(generator) / photons;
+        }
+      }
+      break;
+  }
+}
+
+/**
+ * Clamp sample shades to [0, 1].
+ */
+void augment_clamp(float *sample, int count) {
+  for (int i = 0; i < count; i++) {
+    sample[i] = sample[i] < 0 ? 0 : (sample[i] > 1 ? 1 : sample[i]);
+  }
+}
+
+/**
+ * Make random variant of square sample by spec, buffer has sample size.
+ *
+ * Sample is mirrored, rotated, scaled and shifted by one resampling, then
+ * blurred and noised. Every range is used from zero to its maximum.
+ */
+void augment_sample(const float *sample, int size, const augmentation_spec &spec, std::mt19937 &generator, float *result, float *buffer) {
+  std::uniform_real_distribution<float> uniform(-1, 1);
+  float angle = spec.rotation * uniform(generator);
+  float scale = 1 + spec.scale * uniform(generator);
+  float shift_x = spec.shift * uniform(generator);
+  float shift_y = spec.shift * uniform(generator);
+  const float *source = sample;
+  if (spec.mirroring && uniform(generator) < 0) {
+    for (int y = 0; y < size; y++) {
+      for (int x = 0; x < size; x++) {
+        buffer[y * size + x] = sample[y * size + size - 1 - x];
+      }
+    }
+    source = buffer;
+  }
+  augment_affine(source, size, size, angle, scale, shift_x, shift_y, result);
+  if (spec.blur > 0) {
+    augment_gaussian_blur(result, size, size, spec.blur * fabs(uniform(generator)), buffer);
+  }
+  if (spec.noise > 0) {
+    std::uniform_int_distribution<int> noise_distribution(augmentation_noise_uniform, augmentation_noise_poisson);
+    augmentation_noise noise = (augmentation_noise) noise_distribution(generator);
+    augment_noise(result, size * size, noise, spec.noise * fabs(uniform(generator)), generator);
+  }
+  augment_clamp(result, size * size);
+}
@@ -0,0 +1,63 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <random>
+
+// Noise models of samples augmentation, in order of Magick noise types.
+enum augmentation_noise {
+  augmentation_noise_uniform,
+  augmentation_noise_gaussian,
+  augmentation_noise_multiplicative_gaussian,
+  augmentation_noise_impulse,
+  augmentation_noise_laplacian,
+  augmentation_noise_poisson
+};
+
+// Rotate, scale and shift sample around its center with bilinear resampling.
+void augment_affine(const float *sample, int w, int h, float angle, float scale, float shift_x, float shift_y, float *result);
+// Blur sample by box of radius, buffer has sample size.
+void augment_box_blur(float *sample, int w, int h, int radius, float *buffer);
+// Blur sample by Gaussian kernel, buffer has sample size.
+void augment_gaussian_blur(float *sample, int w, int h, float sigma, float *buffer);
+// Change sample brightness and contrast around middle shade.
+void augment_brightness_contrast(float *sample, int count, float brightness, float contrast);
+// Add noise of model with amount to sample.
+void augment_noise(float *sample, int count, augmentation_noise noise, float amount, std::mt19937 &generator);
+// Clamp sample shades to [0, 1].
+void augment_clamp(float *sample, int count);
+
+// Random augmentation ranges of training sample.
+struct augmentation_spec {
+  // Variants count per training step.
+  unsigned int count;
+  // Maximum rotation angle in degrees.
+  float rotation;
+  // Maximum relative scale change.
+  float scale;
+  // Maximum shift in pixels.
+  float shift;
+  // Maximum Gaussian blur sigma.
+  float blur;
+  // Maximum noise amount, noise model is random.
+  float noise;
+  // Use random horizontal mirroring.
+  bool mirroring;
+  // Random seed.
+  unsigned long long seed;
+};
+
+// Make random variant of square sample by spec, buffer has sample size.
+void augment_sample(const float *sample, int size, const augmentation_spec &spec, std::mt19937 &generator, float *result, float *buffer);
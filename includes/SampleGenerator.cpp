@@ -0,0 +1,116 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <phpcpp.h>
+#include <Magick++.h>
+#include <string.h>
+#include <vector>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include "SimpleImageHelpers.h"
+#include "ThreadPool.h"
+#include "SampleStore.h"
+#include "SampleAugmentation.h"
+#include "SampleGenerator.h"
+
+/**
+ * SampleGenerator constructor.
+ */
+SampleGenerator::SampleGenerator(int size, unsigned long long seed, ThreadPool *thread_pool) {
+  this->size = size;
+  this->seed = seed;
+  this->thread_pool = thread_pool;
+}
+
+/**
+ * Crop image to square and downsample it to samples size.
+ *
+ * Get source pixels shade, row by row.
+ */
+std::vector<float> SampleGenerator::prepareImage(Magick::Image image) {
+  image = image_crop_by_min_size(image);
+  image.type(Magick::GrayscaleType);
+  int side = image.columns();
+  std::vector<float> pixels(side * side), source(this->size * this->size);
+  image_pixels_shade(image, pixels.data());
+  downsample_pixels(pixels.data(), side, side, (float) side / this->size, source.data(), this->size, this->size);
+  return source;
+}
+
+/**
+ * Create samples count from random sources and write them.
+ */
+void SampleGenerator::generate(std::vector<std::vector<float> > &sources, sample_stream stream, bool rotation, unsigned int count, SampleWriter &writer) {
+  unsigned int sample_size = this->size * this->size, batch_count, groups_count;
+  std::vector<float> samples((size_t) sample_generator_batch * sample_size);
+  for (unsigned int first = 0; first < count; first += sample_generator_batch) {
+    batch_count = count - first < sample_generator_batch ? count - first : sample_generator_batch;
+    groups_count = (batch_count + sample_generator_group - 1) / sample_generator_group;
+    this->thread_pool->run(groups_count, [&](unsigned int worker_index, unsigned int group_index) {
+      unsigned int begin = group_index * sample_generator_group;
+      unsigned int end = begin + sample_generator_group < batch_count ? begin + sample_generator_group : batch_count;
+      std::seed_seq sequence{(unsigned int) this->seed, (unsigned int) (this->seed >> 32), (unsigned int) stream, (first + begin) / sample_generator_group};
+      std::mt19937 generator(sequence);
+      for (unsigned int i = begin; i < end; i++) {
+        std::vector<float> &source = sources[random_int(generator, 0, sources.size() - 1)];
+        this->createSample(source, rotation, generator, samples.data() + (size_t) i * sample_size);
+      }
+    });
+    for (unsigned int i = 0; i < batch_count; i++) {
+      writer.write(samples.data() + (size_t) i * sample_size);
+    }
+  }
+}
+
+/**
+ * Create one sample from source pixels by random effects.
+ *
+ * Brightness and contrast jitter takes place of Magick shade effect.
+ */
+void SampleGenerator::createSample(const std::vector<float> &source, bool rotation, std::mt19937 &generator, float *sample) {
+  int count = this->size * this->size;
+  std::vector<float> buffer(count);
+
+  // Rotate sample.
+  if (rotation) {
+    augment_affine(source.data(), this->size, this->size, random_int(generator, -25, 25), 1, 0, 0, sample);
+  }
+  else {
+    memcpy(sample, source.data(), count * sizeof(float));
+  }
+  // Try blur sample.
+  if ((bool) random_int(generator, 0, 1)) {
+    if ((bool) random_int(generator, 0, 1)) {
+      augment_gaussian_blur(sample, this->size, this->size, (float) 1 / random_int(generator, 1, 10), buffer.data());
+    }
+    else {
+      augment_box_blur(sample, this->size, this->size, 1, buffer.data());
+    }
+  }
+  // Try change brightness and contrast.
+  if ((bool) random_int(generator, 0, 1)) {
+    augment_brightness_contrast(sample, count, random_int(generator, -20, 20) / 100.0f, random_int(generator, 70, 130) / 100.0f);
+  }
+  // Try add noise to sample.
+  if ((bool) random_int(generator, 0, 1)) {
+    augment_noise(sample, count, (augmentation_noise) random_int(generator, 0, 5), random_int(generator, 1, 10) / 100.0f, generator);
+  }
+  augment_clamp(sample, count);
+}
@@ -0,0 +1,57 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <vector>
+#include <random>
+
+// Samples count generated between writes.
+const unsigned int sample_generator_batch = 1024;
+// Samples count made by one random generator, batch is divided by it.
+const unsigned int sample_generator_group = 64;
+
+// Samples streams, every stream has own random generators.
+enum sample_stream {
+  sample_stream_negative,
+  sample_stream_positive
+};
+
+/**
+ * Parallel samples generator.
+ *
+ * Source images are cropped to square and downsampled to samples size
+ * once, then every sample is made from source pixels by augmentation
+ * kernels: rotation, blur, brightness and contrast, noise. Every group of
+ * consecutive samples has own random generator seeded by run seed, stream
+ * and group index, so samples do not depend on threads count and a run is
+ * reproduced by its seed. Samples are created by batches in thread pool and written in order.
+ */
+class SampleGenerator {
+  public:
+    // Sample generator constructor.
+    SampleGenerator(int size, unsigned long long seed, ThreadPool *thread_pool);
+    // Crop image to square and downsample it to samples size.
+    std::vector<float> prepareImage(Magick::Image image);
+    // Create samples count from random sources and write them.
+    void generate(std::vector<std::vector<float> > &sources, sample_stream stream, bool rotation, unsigned int count, SampleWriter &writer);
+    // Create one sample from source pixels by random effects.
+    void createSample(const std::vector<float> &source, bool rotation, std::mt19937 &generator, float *sample);
+  protected:
+    // Samples size.
+    int size;
+    // Run seed.
+    unsigned long long seed;
+    ThreadPool *thread_pool;
+};
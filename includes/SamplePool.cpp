@@ -0,0 +1,146 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <phpcpp.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include "SimpleImageHelpers.h"
+#include "SamplePool.h"
+
+// Slots alignment in bytes, one cache line.
+const size_t sample_pool_alignment = 64;
+
+/**
+ * SamplePool constructor.
+ */
+SamplePool::SamplePool(int size, unsigned int capacity) {
+  size_t slot_floats = sample_pool_alignment / sizeof(float);
+  this->sample_size = size;
+  // Padded integral image with slot rounded up to alignment.
+  this->slot_size = ((size_t) (size + 1) * (size + 1) + slot_floats - 1) / slot_floats * slot_floats;
+  this->block = NULL;
+  this->capacity = 0;
+  this->reserve(capacity);
+}
+
+/**
+ * SamplePool destructor.
+ */
+SamplePool::~SamplePool() {
+  free(this->block);
+}
+
+/**
+ * Get samples count.
+ */
+unsigned int SamplePool::size() {
+  return this->pointers.size();
+}
+
+/**
+ * Get samples size.
+ */
+int SamplePool::sampleSize() {
+  return this->sample_size;
+}
+
+/**
+ * Get sample by index.
+ */
+float* SamplePool::sample(unsigned int index) {
+  return this->pointers[index];
+}
+
+/**
+ * Get all samples pointers.
+ */
+std::vector<float*>& SamplePool::samples() {
+  return this->pointers;
+}
+
+/**
+ * Reserve slots for samples count.
+ */
+void SamplePool::reserve(unsigned int capacity) {
+  if (capacity <= this->capacity) {
+    return;
+  }
+  void *block;
+  if (posix_memalign(&block, sample_pool_alignment, capacity * this->slot_size * sizeof(float)) != 0) {
+    throw Php::Exception("Simple Image: Not enough memory for training samples");
+  }
+  if (this->block != NULL) {
+    memcpy(block, this->block, this->pointers.size() * this->slot_size * sizeof(float));
+    free(this->block);
+  }
+  this->block = (float*) block;
+  this->capacity = capacity;
+  for (unsigned int i = 0; i < this->pointers.size(); i++) {
+    this->pointers[i] = this->block + i * this->slot_size;
+  }
+}
+
+/**
+ * Add integral image of sample, get its slot.
+ */
+float* SamplePool::add(float *sample) {
+  if (this->pointers.size() == this->capacity) {
+    this->reserve(this->capacity < 16 ? 16 : this->capacity * 2);
+  }
+  float *slot = this->block + this->pointers.size() * this->slot_size;
+  compute_padded_integral_image(sample, this->sample_size, this->sample_size, false, slot);
+  this->pointers.push_back(slot);
+  return slot;
+}
+
+/**
+ * Add ready integral image, get its slot.
+ */
+float* SamplePool::addIntegralImage(const float *integral_image) {
+  if (this->pointers.size() == this->capacity) {
+    this->reserve(this->capacity < 16 ? 16 : this->capacity * 2);
+  }
+  float *slot = this->block + this->pointers.size() * this->slot_size;
+  memcpy(slot, integral_image, (size_t) (this->sample_size + 1) * (this->sample_size + 1) * sizeof(float));
+  this->pointers.push_back(slot);
+  return slot;
+}
+
+/**
+ * Remove sample by index, the last sample takes its slot.
+ */
+void SamplePool::remove(unsigned int index) {
+  unsigned int last = this->pointers.size() - 1;
+  if (index != last) {
+    memcpy(this->pointers[index], this->pointers[last], this->slot_size * sizeof(float));
+  }
+  this->pointers.pop_back();
+}
+
+/**
+ * Remove the last sample.
+ */
+void SamplePool::removeLast() {
+  this->pointers.pop_back();
+}
+
+/**
+ * Remove all samples, memory block is kept.
+ */
+void SamplePool::clear() {
+  this->pointers.clear();
+}
@@ -0,0 +1,61 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <vector>
+
+/**
+ * Training samples pool.
+ *
+ * Keeps integral images of one size in one aligned memory block, every
+ * sample has own slot addressed by index. Removal moves the last sample
+ * to the removed slot, so samples order is not kept. Samples pointers
+ * are valid until the pool grows over reserved capacity.
+ */
+class SamplePool {
+  public:
+    // Sample pool constructor and destructor.
+    SamplePool(int size, unsigned int capacity);
+    ~SamplePool();
+    // Get samples count.
+    unsigned int size();
+    // Get samples size.
+    int sampleSize();
+    // Get sample by index.
+    float* sample(unsigned int index);
+    // Get all samples pointers.
+    std::vector<float*>& samples();
+    // Reserve slots for samples count.
+    void reserve(unsigned int capacity);
+    // Add integral image of sample, get its slot.
+    float* add(float *sample);
+    // Add ready integral image, get its slot.
+    float* addIntegralImage(const float *integral_image);
+    // Remove sample by index, the last sample takes its slot.
+    void remove(unsigned int index);
+    // Remove the last sample.
+    void removeLast();
+    // Remove all samples, memory block is kept.
+    void clear();
+  protected:
+    // Samples size and slot size in floats.
+    int sample_size;
+    size_t slot_size;
+    // Slots memory block and its capacity in samples.
+    float *block;
+    unsigned int capacity;
+    // Samples pointers in slots order.
+    std::vector<float*> pointers;
+};
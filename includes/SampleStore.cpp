@@ -0,0 +1,285 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <phpcpp.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+#include "SimpleImageHelpers.h"
+#include "SampleStore.h"
+
+/**
+ * SampleWriter constructor.
+ */
+SampleWriter::SampleWriter(std::string path, int w, int h, sample_store_format format) {
+  this->w = w;
+  this->h = h;
+  this->format = format;
+  this->count = 0;
+  if (format == sample_format_text) {
+    this->file.open(path, std::ios::out);
+  }
+  else {
+    this->file.open(path, std::ios::out | std::ios::binary);
+  }
+  if (!this->file.is_open()) {
+    throw Php::Exception("Simple Image: Samples file can not be created");
+  }
+
+  if (format != sample_format_text) {
+    // Header is written again with samples count on close.
+    sample_store_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "SIMGSMPL", 8);
+    header.version = sample_store_version;
+    header.format = format;
+    header.w = w;
+    header.h = h;
+    this->file.write((const char*) &header, sizeof(header));
+    this->buffer.resize(w * h);
+  }
+}
+
+/**
+ * SampleWriter destructor.
+ */
+SampleWriter::~SampleWriter() {
+  this->close();
+}
+
+/**
+ * Write sample pixels shades.
+ */
+void SampleWriter::write(const float *sample) {
+  int WxH = this->w * this->h;
+  float value;
+
+  switch (this->format) {
+    case sample_format_text:
+      if (this->count > 0) {
+        this->file << "\n";
+      }
+      for (int i = 0; i < WxH; i++) {
+        this->file << std::to_string(sample[i]);
+        if (i != WxH - 1) {
+          this->file << " ";
+        }
+      }
+      break;
+    case sample_format_float:
+      this->file.write((const char*) sample, WxH * sizeof(float));
+      break;
+    case sample_format_uint8:
+      for (int i = 0; i < WxH; i++) {
+        value = sample[i] < 0 ? 0 : (sample[i] > 1 ? 1 : sample[i]);
+        this->buffer[i] = (unsigned char) lroundf(value * 255);
+      }
+      this->file.write((const char*) this->buffer.data(), WxH);
+      break;
+  }
+  this->count++;
+}
+
+/**
+ * Finish file.
+ */
+void SampleWriter::close() {
+  if (!this->file.is_open()) {
+    return;
+  }
+  if (this->format != sample_format_text) {
+    this->file.seekp(offsetof(sample_store_header, count));
+    this->file.write((const char*) &this->count, sizeof(this->count));
+  }
+  this->file.close();
+}
+
+/**
+ * SampleReader constructor.
+ *
+ * Zero sizes are taken from binary file header.
+ */
+SampleReader::SampleReader(std::string path, int w, int h) {
+  this->w = w;
+  this->h = h;
+  this->mapped = NULL;
+  this->mapped_size = 0;
+  this->header = NULL;
+  this->pixels = NULL;
+  this->index = 0;
+
+  if (!SampleReader::isBinaryFile(path)) {
+    if (w <= 0 || h <= 0) {
+      throw Php::Exception("Simple Image: Samples size must be given for text samples file");
+    }
+    this->text_file.open(path);
+    if (!this->text_file.is_open()) {
+      throw Php::Exception("Simple Image: Samples file not exist");
+    }
+    return;
+  }
+
+  int file = open(path.c_str(), O_RDONLY);
+  struct stat file_stat;
+  if (file == -1 || fstat(file, &file_stat) != 0) {
+    if (file != -1) {
+      ::close(file);
+    }
+    throw Php::Exception("Simple Image: Samples file not exist");
+  }
+  if ((size_t) file_stat.st_size < sizeof(sample_store_header)) {
+    ::close(file);
+    throw Php::Exception("Simple Image: Wrong samples file format");
+  }
+  this->mapped_size = file_stat.st_size;
+  this->mapped = mmap(NULL, this->mapped_size, PROT_READ, MAP_PRIVATE, file, 0);
+  ::close(file);
+  if (this->mapped == MAP_FAILED) {
+    throw Php::Exception("Simple Image: Samples file can not be mapped in memory");
+  }
+
+  this->header = (sample_store_header*) this->mapped;
+  this->pixels = (const char*) this->mapped + sizeof(sample_store_header);
+  size_t pixel_size = this->header->format == sample_format_uint8 ? 1 : sizeof(float);
+  if (this->header->version != sample_store_version || (this->header->format != sample_format_float && this->header->format != sample_format_uint8)
+      || this->header->w <= 0 || this->header->h <= 0
+      || this->header->count > (this->mapped_size - sizeof(sample_store_header)) / ((size_t) this->header->w * this->header->h * pixel_size)) {
+    munmap(this->mapped, this->mapped_size);
+    throw Php::Exception("Simple Image: Wrong samples file format");
+  }
+  if ((w > 0 && w != this->header->w) || (h > 0 && h != this->header->h)) {
+    munmap(this->mapped, this->mapped_size);
+    throw Php::Exception("Simple Image: Samples file has other samples size");
+  }
+  this->w = this->header->w;
+  this->h = this->header->h;
+  // Pages are read once in order.
+  madvise(this->mapped, this->mapped_size, MADV_SEQUENTIAL);
+}
+
+/**
+ * SampleReader destructor.
+ */
+SampleReader::~SampleReader() {
+  if (this->mapped != NULL) {
+    munmap(this->mapped, this->mapped_size);
+  }
+}
+
+/**
+ * Get samples width.
+ */
+int SampleReader::width() {
+  return this->w;
+}
+
+/**
+ * Get samples height.
+ */
+int SampleReader::height() {
+  return this->h;
+}
+
+/**
+ * Read next sample in buffer, get false at end of file.
+ */
+bool SampleReader::read(float *sample) {
+  size_t WxH = (size_t) this->w * this->h;
+
+  if (this->mapped == NULL) {
+    while (std::getline(this->text_file, this->line)) {
+      if (parse_sample_string(this->line, this->w, this->h, sample)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  if (this->index >= this->header->count) {
+    return false;
+  }
+  if (this->header->format == sample_format_float) {
+    memcpy(sample, this->pixels + this->index * WxH * sizeof(float), WxH * sizeof(float));
+  }
+  else {
+    const unsigned char *values = (const unsigned char*) this->pixels + this->index * WxH;
+    for (size_t i = 0; i < WxH; i++) {
+      sample[i] = values[i] / 255.0f;
+    }
+  }
+  this->index++;
+  return true;
+}
+
+/**
+ * Get reading position, it can be restored by seek.
+ *
+ * Position is byte offset of the next line for text file and the next
+ * sample index for binary file.
+ */
+unsigned long long SampleReader::position() {
+  if (this->mapped != NULL) {
+    return this->index;
+  }
+  if (!this->text_file.good()) {
+    // Whole file is read.
+    this->text_file.clear();
+    this->text_file.seekg(0, std::ios::end);
+  }
+  return this->text_file.tellg();
+}
+
+/**
+ * Continue reading from position.
+ */
+void SampleReader::seek(unsigned long long position) {
+  if (this->mapped != NULL) {
+    this->index = position < this->header->count ? position : this->header->count;
+    return;
+  }
+  this->text_file.clear();
+  this->text_file.seekg(position);
+}
+
+/**
+ * Check, that file is binary samples file.
+ */
+bool SampleReader::isBinaryFile(std::string path) {
+  char magic[8];
+  std::ifstream file(path, std::ios::binary);
+  return file.read(magic, 8) && memcmp(magic, "SIMGSMPL", 8) == 0;
+}
+
+/**
+ * Get samples file format by name.
+ */
+sample_store_format sample_format_from_string(std::string name) {
+  if (name == "text") {
+    return sample_format_text;
+  }
+  if (name == "float") {
+    return sample_format_float;
+  }
+  if (name == "uint8") {
+    return sample_format_uint8;
+  }
+  throw Php::Exception("Simple Image: Samples format must be text, float or uint8");
+}
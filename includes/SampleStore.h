@@ -0,0 +1,113 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <fstream>
+#include <vector>
+
+// Binary samples file format version.
+const unsigned int sample_store_version = 1;
+
+// Samples file formats.
+enum sample_store_format {
+  // One sample per line, pixels shades separated by spaces.
+  sample_format_text,
+  // Binary file with float32 pixels shades.
+  sample_format_float,
+  // Binary file with uint8 pixels shades, shade 1 is 255.
+  sample_format_uint8
+};
+
+// Binary samples file header, samples pixels follow it.
+struct sample_store_header {
+  // File signature "SIMGSMPL".
+  char magic[8];
+  // Format version.
+  unsigned int version;
+  // Pixels format.
+  unsigned int format;
+  // Samples sizes.
+  int w;
+  int h;
+  // Samples count.
+  unsigned long long count;
+};
+
+/**
+ * Sequential samples file writer.
+ *
+ * Binary file gets samples count in header, when writer is closed.
+ */
+class SampleWriter {
+  public:
+    // Sample writer constructor and destructor.
+    SampleWriter(std::string path, int w, int h, sample_store_format format);
+    ~SampleWriter();
+    // Write sample pixels shades.
+    void write(const float *sample);
+    // Finish file.
+    void close();
+  protected:
+    // Output file.
+    std::ofstream file;
+    // Samples sizes and format.
+    int w, h;
+    sample_store_format format;
+    // Written samples count.
+    unsigned long long count;
+    // Pixels conversion buffer.
+    std::vector<unsigned char> buffer;
+};
+
+/**
+ * Sequential samples file reader.
+ *
+ * Binary file is mapped in memory and samples are copied in caller
+ * buffer, so reading does not allocate memory per sample. Text lines
+ * with wrong pixels count are skipped, as before.
+ */
+class SampleReader {
+  public:
+    // Sample reader constructor and destructor.
+    SampleReader(std::string path, int w, int h);
+    ~SampleReader();
+    // Get samples sizes.
+    int width();
+    int height();
+    // Read next sample in buffer, get false at end of file.
+    bool read(float *sample);
+    // Get reading position, it can be restored by seek.
+    unsigned long long position();
+    // Continue reading from position.
+    void seek(unsigned long long position);
+    // Check, that file is binary samples file.
+    static bool isBinaryFile(std::string path);
+  protected:
+    // Samples sizes.
+    int w, h;
+    // Text file and current line.
+    std::ifstream text_file;
+    std::string line;
+    // Mapped binary file and it size.
+    void *mapped;
+    size_t mapped_size;
+    // Binary file header, pixels and next sample index.
+    sample_store_header *header;
+    const char *pixels;
+    unsigned long long index;
+};
+
+// Get samples file format by name.
+sample_store_format sample_format_from_string(std::string name);
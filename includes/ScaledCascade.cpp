@@ -0,0 +1,589 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <phpcpp.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "HaarFeature.h"
+#include "WeaklyClassifier.h"
+#include "ForcefulClassifier.h"
+#include "CascadeClassifier.h"
+#include "CompiledCascade.h"
+#include "ScaledCascade.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SIMPLE_IMAGE_X86_SIMD
+#define SIMPLE_IMAGE_TARGET(instructions) __attribute__((target(instructions)))
+#endif
+
+// Batch instructions set levels.
+enum cascade_simd_level {
+  cascade_simd_scalar,
+  cascade_simd_sse4,
+  cascade_simd_avx2
+};
+
+/**
+ * Detect best batch instructions set supported by CPU.
+ */
+static cascade_simd_level detect_cascade_simd_level() {
+#ifdef SIMPLE_IMAGE_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return cascade_simd_avx2;
+  }
+  if (__builtin_cpu_supports("sse4.1")) {
+    return cascade_simd_sse4;
+  }
+#endif
+  return cascade_simd_scalar;
+}
+
+// Batch instructions set level of current CPU.
+static const cascade_simd_level cascade_simd = detect_cascade_simd_level();
+
+/**
+ * ScaledCascade constructor.
+ *
+ * Features and limits are scaled step by step with the same rounding, as
+ * CascadeClassifier::scaleByValue does it.
+ */
+ScaledCascade::ScaledCascade(CompiledCascade *compiled_cascade, unsigned int scale_steps, float scale_step, float limit_scale, unsigned int stride) {
+  compiled_cascade_arrays &arrays = compiled_cascade->getArrays();
+  int type, x, y, w, h;
+  float limit, bin_width, weight;
+
+  this->size = compiled_cascade->scaledSize(scale_steps, scale_step);
+  this->soft = compiled_cascade->isSoft();
+  this->stride = stride;
+  this->stages_count = compiled_cascade->stagesCount();
+  this->weakly_count = compiled_cascade->weaklyCount();
+
+  // Place arrays in one block.
+  this->block = new char[((size_t) 2 * this->stages_count + 1 + (size_t) 23 * this->weakly_count + compiled_cascade->tableCount()) * 4];
+  this->stage_first = (unsigned int*) this->block;
+  this->stage_limit = (float*) (this->stage_first + this->stages_count + 1);
+  this->rect_offsets = (int*) (this->stage_limit + this->stages_count);
+  this->rect_weights = (float*) (this->rect_offsets + 12 * this->weakly_count);
+  this->odd_area = this->rect_weights + 3 * this->weakly_count;
+  this->weakly_limit = this->odd_area + this->weakly_count;
+  this->below_vote = this->weakly_limit + this->weakly_count;
+  this->above_vote = this->below_vote + this->weakly_count;
+  this->table_bins = (unsigned int*) (this->above_vote + this->weakly_count);
+  this->table_bin_width = (float*) (this->table_bins + this->weakly_count);
+  this->table_first = (unsigned int*) (this->table_bin_width + this->weakly_count);
+  this->table_values = (float*) (this->table_first + this->weakly_count);
+  this->weakly_rejection = this->table_values + compiled_cascade->tableCount();
+
+  for (unsigned int i = 0; i < this->stages_count; i++) {
+    this->stage_first[i] = arrays.stage_first[i];
+    this->stage_limit[i] = arrays.stage_limit[i];
+    this->stage_limit[i] *= limit_scale;
+  }
+  this->stage_first[this->stages_count] = arrays.stage_first[this->stages_count];
+
+  for (unsigned int i = 0; i < this->weakly_count; i++) {
+    type = arrays.feature_type[i];
+    x = arrays.feature_x[i];
+    y = arrays.feature_y[i];
+    w = arrays.feature_w[i];
+    h = arrays.feature_h[i];
+    limit = arrays.weakly_limit[i];
+    bin_width = arrays.table_bin_width[i];
+    for (unsigned int step = 0; step < scale_steps; step++) {
+      x = x * scale_step;
+      y = y * scale_step;
+      w = w * scale_step;
+      h = h * scale_step;
+      limit *= pow(scale_step, 2);
+      bin_width *= pow(scale_step, 2);
+    }
+
+    // Rectangles in the same order and with the same signs as in HaarFeature::value.
+    switch (type) {
+      case 0:
+        this->setRectangle(i, 0, x + (w / 2), y, w / 2, h, 1);
+        this->setRectangle(i, 1, x, y, w / 2, h, -1);
+        this->setRectangle(i, 2, 0, 0, 0, 0, 0);
+        break;
+      case 1:
+        this->setRectangle(i, 0, x, y, w, h / 2, 1);
+        this->setRectangle(i, 1, x, y + (h / 2), w, h / 2, -1);
+        this->setRectangle(i, 2, 0, 0, 0, 0, 0);
+        break;
+      case 2:
+        this->setRectangle(i, 0, x + (w / 3), y, w / 3, h, 1);
+        this->setRectangle(i, 1, x, y, w / 3, h, -1);
+        this->setRectangle(i, 2, x + (w * 2 / 3), y, w / 3, h, -1);
+        break;
+      case 3:
+        this->setRectangle(i, 0, x, y + (h / 3), w, h / 3, 1);
+        this->setRectangle(i, 1, x, y, w, h / 3, -1);
+        this->setRectangle(i, 2, x, y + (h * 2 / 3), w, h / 3, -1);
+        break;
+      default:
+        delete[] this->block;
+        throw Php::Exception("Simple Image: Feature type does not exist");
+    }
+    // If the number of rectangles is odd.
+    this->odd_area[i] = (type == 2 || type == 3) ? w * h : 0;
+    this->weakly_limit[i] = limit;
+    weight = arrays.weakly_weight[i];
+    this->below_vote[i] = arrays.weakly_state[i] ? weight : -weight;
+    this->above_vote[i] = arrays.weakly_state[i] ? -weight : weight;
+    this->table_bins[i] = arrays.table_bins[i];
+    this->table_bin_width[i] = bin_width;
+    this->table_first[i] = arrays.table_first[i];
+    this->weakly_rejection[i] = arrays.weakly_rejection[i];
+    this->weakly_rejection[i] *= limit_scale;
+    for (unsigned int j = 0; j < arrays.table_bins[i]; j++) {
+      this->table_values[arrays.table_first[i] + j] = weight * arrays.table_values[arrays.table_first[i] + j];
+    }
+  }
+}
+
+/**
+ * ScaledCascade destructor.
+ */
+ScaledCascade::~ScaledCascade() {
+  delete[] this->block;
+}
+
+/**
+ * Get classifier size property.
+ */
+int ScaledCascade::getSize() {
+  return this->size;
+}
+
+/**
+ * Get integral image row stride.
+ */
+unsigned int ScaledCascade::getStride() {
+  return this->stride;
+}
+
+/**
+ * Get stages count.
+ */
+unsigned int ScaledCascade::stagesCount() {
+  return this->stages_count;
+}
+
+/**
+ * Set rectangle offsets and weight.
+ *
+ * Corners are stored in D, C, B, A order - bottom-right, bottom-left,
+ * top-right and top-left, as HaarFeature::valueHelper reads them.
+ */
+void ScaledCascade::setRectangle(unsigned int weakly_index, unsigned int rect_index, int x, int y, int w, int h, float weight) {
+  int *offsets = this->rect_offsets + 12 * weakly_index + 4 * rect_index;
+  int stride = this->stride;
+  offsets[0] = (y + h) * stride + x + w;
+  offsets[1] = (y + h) * stride + x;
+  offsets[2] = y * stride + x + w;
+  offsets[3] = y * stride + x;
+  this->rect_weights[3 * weakly_index + rect_index] = weight;
+}
+
+/**
+ * Get weakly classifier vote for feature value.
+ */
+inline float ScaledCascade::weaklyVote(unsigned int weakly_index, float value) {
+  if (this->table_bins[weakly_index] == 0) {
+    return value < this->weakly_limit[weakly_index] ? this->below_vote[weakly_index] : this->above_vote[weakly_index];
+  }
+  return this->table_values[this->table_first[weakly_index] + WeaklyClassifier::tableBin(value, this->weakly_limit[weakly_index], this->table_bin_width[weakly_index], this->table_bins[weakly_index])];
+}
+
+/**
+ * Classify window stage by stage.
+ *
+ * Statistics code is removed by compiler from instantiation without them.
+ */
+template <bool profile>
+bool ScaledCascade::classifyWindowStages(const float *window, float temp1, float temp2, cascade_stats *stats) {
+  const int *offsets;
+  const float *weights;
+  float counter, value, a, b, c;
+  unsigned int weakly_index = 0, last_index;
+
+  if (profile) {
+    stats->windows++;
+  }
+  counter = 0;
+  for (unsigned int stage = 0; stage < this->stages_count; stage++) {
+    if (!this->soft) {
+      counter = 0;
+    }
+    last_index = this->stage_first[stage + 1];
+    if (profile) {
+      stats->weakly_evaluated += last_index - weakly_index;
+    }
+    for (; weakly_index < last_index; weakly_index++) {
+      offsets = this->rect_offsets + 12 * weakly_index;
+      weights = this->rect_weights + 3 * weakly_index;
+      a = window[offsets[0]] - window[offsets[1]] - window[offsets[2]] + window[offsets[3]];
+      b = window[offsets[4]] - window[offsets[5]] - window[offsets[6]] + window[offsets[7]];
+      c = window[offsets[8]] - window[offsets[9]] - window[offsets[10]] + window[offsets[11]];
+      value = a * weights[0] + b * weights[1] + c * weights[2];
+      value += this->odd_area[weakly_index] * temp1 / 3;
+      if (temp2 != 0) {
+        value = value / temp2;
+      }
+      counter += this->weaklyVote(weakly_index, value);
+      if (this->soft && counter < this->weakly_rejection[weakly_index]) {
+        if (profile) {
+          stats->weakly_evaluated -= last_index - weakly_index - 1;
+        }
+        return false;
+      }
+    }
+    if (counter < this->stage_limit[stage]) {
+      return false;
+    }
+    if (profile) {
+      stats->stage_passed[stage]++;
+    }
+  }
+  return true;
+}
+
+/**
+ * Classify window, which top-left corner is pointed in padded integral image.
+ */
+bool ScaledCascade::classifyWindow(const float *window, float temp1, float temp2) {
+  return this->classifyWindowStages<false>(window, temp1, temp2, NULL);
+}
+
+/**
+ * Classify window and collect statistics.
+ */
+bool ScaledCascade::classifyWindow(const float *window, float temp1, float temp2, cascade_stats &stats) {
+  return this->classifyWindowStages<true>(window, temp1, temp2, &stats);
+}
+
+/**
+ * Get last stage votes sum minus its limit for window.
+ *
+ * Margin is used as detection confidence, so it is calculated only for
+ * windows accepted by whole cascade. Soft cascade last stage limit is for
+ * votes sum of all stages.
+ */
+float ScaledCascade::lastStageMargin(const float *window, float temp1, float temp2) {
+  const int *offsets;
+  const float *weights;
+  float counter = 0, value, a, b, c;
+  unsigned int stage = this->stages_count - 1;
+
+  if (this->stages_count == 0) {
+    return 0;
+  }
+  for (unsigned int weakly_index = this->soft ? 0 : this->stage_first[stage]; weakly_index < this->stage_first[stage + 1]; weakly_index++) {
+    offsets = this->rect_offsets + 12 * weakly_index;
+    weights = this->rect_weights + 3 * weakly_index;
+    a = window[offsets[0]] - window[offsets[1]] - window[offsets[2]] + window[offsets[3]];
+    b = window[offsets[4]] - window[offsets[5]] - window[offsets[6]] + window[offsets[7]];
+    c = window[offsets[8]] - window[offsets[9]] - window[offsets[10]] + window[offsets[11]];
+    value = a * weights[0] + b * weights[1] + c * weights[2];
+    value += this->odd_area[weakly_index] * temp1 / 3;
+    if (temp2 != 0) {
+      value = value / temp2;
+    }
+    counter += this->weaklyVote(weakly_index, value);
+  }
+  return counter - this->stage_limit[stage];
+}
+
+#ifdef SIMPLE_IMAGE_X86_SIMD
+
+/**
+ * Load four windows values by offset.
+ */
+SIMPLE_IMAGE_TARGET("sse4.1")
+static inline __m128 load_lanes_sse4(const float *const *windows, int offset) {
+  return _mm_set_ps(windows[3][offset], windows[2][offset], windows[1][offset], windows[0][offset]);
+}
+
+/**
+ * Calculate four windows rectangle sums.
+ */
+SIMPLE_IMAGE_TARGET("sse4.1")
+static inline __m128 rectangle_lanes_sse4(const float *const *windows, const int *offsets) {
+  __m128 result = load_lanes_sse4(windows, offsets[0]);
+  result = _mm_sub_ps(result, load_lanes_sse4(windows, offsets[1]));
+  result = _mm_sub_ps(result, load_lanes_sse4(windows, offsets[2]));
+  return _mm_add_ps(result, load_lanes_sse4(windows, offsets[3]));
+}
+
+/**
+ * Get four windows lookup table votes.
+ *
+ * Bins are calculated as WeaklyClassifier::tableBin does it.
+ */
+SIMPLE_IMAGE_TARGET("sse4.1")
+static inline __m128 table_lanes_sse4(__m128 value, float limit, float bin_width, unsigned int bins_count, const float *table) {
+  int bins[4];
+  __m128 bin = _mm_floor_ps(_mm_div_ps(_mm_sub_ps(value, _mm_set1_ps(limit)), _mm_set1_ps(bin_width)));
+  bin = _mm_min_ps(_mm_max_ps(bin, _mm_setzero_ps()), _mm_set1_ps(bins_count - 1));
+  _mm_storeu_si128((__m128i*) bins, _mm_cvttps_epi32(bin));
+  return _mm_set_ps(table[bins[3]], table[bins[2]], table[bins[1]], table[bins[0]]);
+}
+
+/**
+ * Classify batch of windows by SSE4.1 instructions.
+ *
+ * Batch is classified as two halves of four windows.
+ */
+SIMPLE_IMAGE_TARGET("sse4.1")
+unsigned int ScaledCascade::classifyBatchSse4(const float *const *windows, const float *temp1, const float *temp2) {
+  const int *offsets;
+  const float *weights;
+  unsigned int weakly_index, last_index, result = 0;
+  __m128 alive, counter, value, odd_temp, divisor, three = _mm_set1_ps(3);
+
+  for (unsigned int half = 0; half < cascade_batch_size; half += 4) {
+    const float *const *half_windows = windows + half;
+    alive = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    odd_temp = _mm_loadu_ps(temp1 + half);
+    divisor = _mm_loadu_ps(temp2 + half);
+    // Zero deviation windows are not divided.
+    divisor = _mm_blendv_ps(divisor, _mm_set1_ps(1), _mm_cmpeq_ps(divisor, _mm_setzero_ps()));
+    weakly_index = 0;
+    counter = _mm_setzero_ps();
+    for (unsigned int stage = 0; stage < this->stages_count; stage++) {
+      if (!this->soft) {
+        counter = _mm_setzero_ps();
+      }
+      last_index = this->stage_first[stage + 1];
+      for (; weakly_index < last_index; weakly_index++) {
+        offsets = this->rect_offsets + 12 * weakly_index;
+        weights = this->rect_weights + 3 * weakly_index;
+        value = _mm_mul_ps(rectangle_lanes_sse4(half_windows, offsets), _mm_set1_ps(weights[0]));
+        value = _mm_add_ps(value, _mm_mul_ps(rectangle_lanes_sse4(half_windows, offsets + 4), _mm_set1_ps(weights[1])));
+        value = _mm_add_ps(value, _mm_mul_ps(rectangle_lanes_sse4(half_windows, offsets + 8), _mm_set1_ps(weights[2])));
+        value = _mm_add_ps(value, _mm_div_ps(_mm_mul_ps(_mm_set1_ps(this->odd_area[weakly_index]), odd_temp), three));
+        value = _mm_div_ps(value, divisor);
+        if (this->table_bins[weakly_index] != 0) {
+          counter = _mm_add_ps(counter, table_lanes_sse4(value, this->weakly_limit[weakly_index], this->table_bin_width[weakly_index], this->table_bins[weakly_index], this->table_values + this->table_first[weakly_index]));
+        }
+        else {
+          counter = _mm_add_ps(counter, _mm_blendv_ps(_mm_set1_ps(this->above_vote[weakly_index]), _mm_set1_ps(this->below_vote[weakly_index]), _mm_cmplt_ps(value, _mm_set1_ps(this->weakly_limit[weakly_index]))));
+        }
+        if (this->soft) {
+          alive = _mm_and_ps(alive, _mm_cmpge_ps(counter, _mm_set1_ps(this->weakly_rejection[weakly_index])));
+          if (_mm_movemask_ps(alive) == 0) {
+            break;
+          }
+        }
+      }
+      alive = _mm_and_ps(alive, _mm_cmpge_ps(counter, _mm_set1_ps(this->stage_limit[stage])));
+      if (_mm_movemask_ps(alive) == 0) {
+        break;
+      }
+    }
+    result |= _mm_movemask_ps(alive) << half;
+  }
+  return result;
+}
+
+/**
+ * Load eight windows values by offset.
+ */
+template <bool gather>
+SIMPLE_IMAGE_TARGET("avx2")
+static inline __m256 load_lanes_avx2(const float *first_window, __m256i lane_offsets, const float *const *windows, int offset) {
+  if (gather) {
+    return _mm256_i32gather_ps(first_window + offset, lane_offsets, 4);
+  }
+  return _mm256_set_ps(windows[7][offset], windows[6][offset], windows[5][offset], windows[4][offset], windows[3][offset], windows[2][offset], windows[1][offset], windows[0][offset]);
+}
+
+/**
+ * Calculate eight windows rectangle sums.
+ */
+template <bool gather>
+SIMPLE_IMAGE_TARGET("avx2")
+static inline __m256 rectangle_lanes_avx2(const float *first_window, __m256i lane_offsets, const float *const *windows, const int *offsets) {
+  __m256 result = load_lanes_avx2<gather>(first_window, lane_offsets, windows, offsets[0]);
+  result = _mm256_sub_ps(result, load_lanes_avx2<gather>(first_window, lane_offsets, windows, offsets[1]));
+  result = _mm256_sub_ps(result, load_lanes_avx2<gather>(first_window, lane_offsets, windows, offsets[2]));
+  return _mm256_add_ps(result, load_lanes_avx2<gather>(first_window, lane_offsets, windows, offsets[3]));
+}
+
+/**
+ * Get eight windows lookup table votes.
+ *
+ * Bins are calculated as WeaklyClassifier::tableBin does it.
+ */
+SIMPLE_IMAGE_TARGET("avx2")
+static inline __m256 table_lanes_avx2(__m256 value, float limit, float bin_width, unsigned int bins_count, const float *table) {
+  __m256 bin = _mm256_floor_ps(_mm256_div_ps(_mm256_sub_ps(value, _mm256_set1_ps(limit)), _mm256_set1_ps(bin_width)));
+  bin = _mm256_min_ps(_mm256_max_ps(bin, _mm256_setzero_ps()), _mm256_set1_ps(bins_count - 1));
+  return _mm256_i32gather_ps(table, _mm256_cvttps_epi32(bin), 4);
+}
+
+/**
+ * Classify batch of windows by AVX2 instructions.
+ *
+ * Windows placed with equal step are loaded by gather instruction.
+ */
+template <bool gather>
+SIMPLE_IMAGE_TARGET("avx2")
+unsigned int ScaledCascade::classifyBatchAvx2(const float *first_window, const int *lane_offsets, const float *const *windows, const float *temp1, const float *temp2) {
+  const int *offsets;
+  const float *weights;
+  unsigned int weakly_index = 0, last_index;
+  __m256i lanes = gather ? _mm256_loadu_si256((const __m256i*) lane_offsets) : _mm256_setzero_si256();
+  __m256 alive = _mm256_castsi256_ps(_mm256_set1_epi32(-1)), counter, value, three = _mm256_set1_ps(3);
+  __m256 odd_temp = _mm256_loadu_ps(temp1), divisor = _mm256_loadu_ps(temp2);
+
+  // Zero deviation windows are not divided.
+  divisor = _mm256_blendv_ps(divisor, _mm256_set1_ps(1), _mm256_cmp_ps(divisor, _mm256_setzero_ps(), _CMP_EQ_OQ));
+  counter = _mm256_setzero_ps();
+  for (unsigned int stage = 0; stage < this->stages_count; stage++) {
+    if (!this->soft) {
+      counter = _mm256_setzero_ps();
+    }
+    last_index = this->stage_first[stage + 1];
+    for (; weakly_index < last_index; weakly_index++) {
+      offsets = this->rect_offsets + 12 * weakly_index;
+      weights = this->rect_weights + 3 * weakly_index;
+      value = _mm256_mul_ps(rectangle_lanes_avx2<gather>(first_window, lanes, windows, offsets), _mm256_set1_ps(weights[0]));
+      value = _mm256_add_ps(value, _mm256_mul_ps(rectangle_lanes_avx2<gather>(first_window, lanes, windows, offsets + 4), _mm256_set1_ps(weights[1])));
+      value = _mm256_add_ps(value, _mm256_mul_ps(rectangle_lanes_avx2<gather>(first_window, lanes, windows, offsets + 8), _mm256_set1_ps(weights[2])));
+      value = _mm256_add_ps(value, _mm256_div_ps(_mm256_mul_ps(_mm256_set1_ps(this->odd_area[weakly_index]), odd_temp), three));
+      value = _mm256_div_ps(value, divisor);
+      if (this->table_bins[weakly_index] != 0) {
+        counter = _mm256_add_ps(counter, table_lanes_avx2(value, this->weakly_limit[weakly_index], this->table_bin_width[weakly_index], this->table_bins[weakly_index], this->table_values + this->table_first[weakly_index]));
+      }
+      else {
+        counter = _mm256_add_ps(counter, _mm256_blendv_ps(_mm256_set1_ps(this->above_vote[weakly_index]), _mm256_set1_ps(this->below_vote[weakly_index]), _mm256_cmp_ps(value, _mm256_set1_ps(this->weakly_limit[weakly_index]), _CMP_LT_OQ)));
+      }
+      if (this->soft) {
+        alive = _mm256_and_ps(alive, _mm256_cmp_ps(counter, _mm256_set1_ps(this->weakly_rejection[weakly_index]), _CMP_GE_OQ));
+        if (_mm256_movemask_ps(alive) == 0) {
+          return 0;
+        }
+      }
+    }
+    alive = _mm256_and_ps(alive, _mm256_cmp_ps(counter, _mm256_set1_ps(this->stage_limit[stage]), _CMP_GE_OQ));
+    if (_mm256_movemask_ps(alive) == 0) {
+      return 0;
+    }
+  }
+  return _mm256_movemask_ps(alive);
+}
+
+#endif
+
+/**
+ * Classify windows placed with equal step, get accepted windows bit mask.
+ *
+ * Count must be from 1 to cascade_batch_size, window step is in floats.
+ */
+unsigned int ScaledCascade::classifyWindows(const float *first_window, int window_step, unsigned int count, const float *temp1, const float *temp2) {
+  const float *windows[cascade_batch_size];
+  int lane_offsets[cascade_batch_size];
+  float lane_temp1[cascade_batch_size], lane_temp2[cascade_batch_size];
+  unsigned int lane;
+
+  // Missing lanes repeat the first window and are masked out of result.
+  for (unsigned int i = 0; i < cascade_batch_size; i++) {
+    lane = i < count ? i : 0;
+    lane_offsets[i] = lane * window_step;
+    windows[i] = first_window + lane_offsets[i];
+    lane_temp1[i] = temp1[lane];
+    lane_temp2[i] = temp2[lane];
+  }
+  switch (cascade_simd) {
+#ifdef SIMPLE_IMAGE_X86_SIMD
+    case cascade_simd_avx2:
+      return this->classifyBatchAvx2<true>(first_window, lane_offsets, windows, lane_temp1, lane_temp2) & ((1u << count) - 1);
+    case cascade_simd_sse4:
+      return this->classifyBatchSse4(windows, lane_temp1, lane_temp2) & ((1u << count) - 1);
+#endif
+    default:
+      return this->classifyBatchScalar(windows, lane_temp1, lane_temp2) & ((1u << count) - 1);
+  }
+}
+
+/**
+ * Classify windows given by pointers, get accepted windows bit mask.
+ *
+ * Count must be from 1 to cascade_batch_size.
+ */
+unsigned int ScaledCascade::classifyWindows(const float *const *windows, unsigned int count, const float *temp1, const float *temp2) {
+  const float *lane_windows[cascade_batch_size];
+  float lane_temp1[cascade_batch_size], lane_temp2[cascade_batch_size];
+  unsigned int lane;
+
+  // Missing lanes repeat the first window and are masked out of result.
+  for (unsigned int i = 0; i < cascade_batch_size; i++) {
+    lane = i < count ? i : 0;
+    lane_windows[i] = windows[lane];
+    lane_temp1[i] = temp1[lane];
+    lane_temp2[i] = temp2[lane];
+  }
+  switch (cascade_simd) {
+#ifdef SIMPLE_IMAGE_X86_SIMD
+    case cascade_simd_avx2:
+      return this->classifyBatchAvx2<false>(NULL, NULL, lane_windows, lane_temp1, lane_temp2) & ((1u << count) - 1);
+    case cascade_simd_sse4:
+      return this->classifyBatchSse4(lane_windows, lane_temp1, lane_temp2) & ((1u << count) - 1);
+#endif
+    default:
+      return this->classifyBatchScalar(lane_windows, lane_temp1, lane_temp2) & ((1u << count) - 1);
+  }
+}
+
+/**
+ * Count accepted samples, each sample is one padded integral image window.
+ *
+ * Samples are not normalized by window, as in training.
+ */
+unsigned int ScaledCascade::countAccepted(std::vector<float*> &samples) {
+  unsigned int samples_count = samples.size(), count, mask, result = 0;
+  float temp1[cascade_batch_size], temp2[cascade_batch_size];
+  for (unsigned int i = 0; i < cascade_batch_size; i++) {
+    temp1[i] = 0;
+    temp2[i] = 1;
+  }
+  for (unsigned int i = 0; i < samples_count; i += cascade_batch_size) {
+    count = samples_count - i < cascade_batch_size ? samples_count - i : cascade_batch_size;
+    mask = this->classifyWindows(&samples[i], count, temp1, temp2);
+    while (mask != 0) {
+      result += mask & 1;
+      mask >>= 1;
+    }
+  }
+  return result;
+}
+
+/**
+ * Classify batch of windows one by one.
+ */
+unsigned int ScaledCascade::classifyBatchScalar(const float *const *windows, const float *temp1, const float *temp2) {
+  unsigned int result = 0;
+  for (unsigned int i = 0; i < cascade_batch_size; i++) {
+    if (this->classifyWindow(windows[i], temp1[i], temp2[i])) {
+      result |= 1u << i;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,105 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Windows count classified by one batch call.
+const unsigned int cascade_batch_size = 8;
+
+/**
+ * Compiled cascade scaled and linked to integral image row stride.
+ *
+ * Holds for every weakly classifier precomputed corner offsets of its
+ * rectangles relative to window top-left corner of padded integral image,
+ * so window classification has no pointer chasing and no feature type
+ * branches. All arrays are parts of one memory block.
+ *
+ * Batch classification evaluates every weakly classifier over several
+ * windows at once with AVX2 or SSE4.1, when CPU supports them. Windows,
+ * rejected by a stage, are masked out, and batch stops, when all windows
+ * are rejected. Results are the same as from single window classification.
+ * Lookup table weakly classifiers read their values by bins of all windows.
+ * Soft cascade keeps votes sum over stages and masks out windows after
+ * each weakly classifier, which rejection limit they do not reach.
+ */
+class ScaledCascade {
+  public:
+    // Scaled cascade constructor and destructor.
+    ScaledCascade(CompiledCascade *compiled_cascade, unsigned int scale_steps, float scale_step, float limit_scale, unsigned int stride);
+    ~ScaledCascade();
+    // Get classifier size property.
+    int getSize();
+    // Get integral image row stride.
+    unsigned int getStride();
+    // Get stages count.
+    unsigned int stagesCount();
+    // Classify window, which top-left corner is pointed in padded integral image.
+    bool classifyWindow(const float *window, float temp1, float temp2);
+    // Classify window and collect statistics, they must be reset for stages count.
+    bool classifyWindow(const float *window, float temp1, float temp2, cascade_stats &stats);
+    // Classify windows placed with equal step, get accepted windows bit mask.
+    unsigned int classifyWindows(const float *first_window, int window_step, unsigned int count, const float *temp1, const float *temp2);
+    // Classify windows given by pointers, get accepted windows bit mask.
+    unsigned int classifyWindows(const float *const *windows, unsigned int count, const float *temp1, const float *temp2);
+    // Get last stage votes sum minus its limit for window, soft cascade sums all stages votes.
+    float lastStageMargin(const float *window, float temp1, float temp2);
+    // Count accepted samples, each sample is one padded integral image window.
+    unsigned int countAccepted(std::vector<float*> &samples);
+  protected:
+    // Classifier basis variable.
+    int size;
+    // Soft cascade flag.
+    bool soft;
+    // Integral image row stride.
+    unsigned int stride;
+    // Classifiers counts.
+    unsigned int stages_count, weakly_count;
+    // Arrays memory block.
+    char *block;
+    // First weakly classifier index of each stage and stages limits.
+    unsigned int *stage_first;
+    float *stage_limit;
+    // Four corners offsets of three rectangles per weakly classifier.
+    int *rect_offsets;
+    // Three rectangles weights per weakly classifier.
+    float *rect_weights;
+    // Feature area for odd rectangles count, zero for even.
+    float *odd_area;
+    // Weakly classifiers limits and votes below and above limit.
+    float *weakly_limit;
+    float *below_vote;
+    float *above_vote;
+    // Lookup tables bins counts, zero for threshold classifiers, bins widths,
+    // first values indexes and values multiplied by weakly classifiers weights.
+    unsigned int *table_bins;
+    float *table_bin_width;
+    unsigned int *table_first;
+    float *table_values;
+    // Soft cascade rejection limits.
+    float *weakly_rejection;
+    // Set rectangle offsets and weight.
+    void setRectangle(unsigned int weakly_index, unsigned int rect_index, int x, int y, int w, int h, float weight);
+    // Get weakly classifier vote for feature value.
+    float weaklyVote(unsigned int weakly_index, float value);
+    // Classify window stage by stage, with statistics or without them.
+    template <bool profile>
+    bool classifyWindowStages(const float *window, float temp1, float temp2, cascade_stats *stats);
+    // Classify batch of windows one by one.
+    unsigned int classifyBatchScalar(const float *const *windows, const float *temp1, const float *temp2);
+    // Classify batch of windows by SSE4.1 instructions.
+    unsigned int classifyBatchSse4(const float *const *windows, const float *temp1, const float *temp2);
+    // Classify batch of windows by AVX2 instructions.
+    template <bool gather>
+    unsigned int classifyBatchAvx2(const float *first_window, const int *lane_offsets, const float *const *windows, const float *temp1, const float *temp2);
+};
@@ -17,7 +17,13 @@ limitations under the License.
 #include <fstream>
 #include <random>
 #include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <unordered_map>
 #include "SimpleImageHelpers.h"
+#include "IntegralImages.h"
 
 /**
  * Set counter params.
@@ -74,11 +80,12 @@ float WeightsSum::getNegative() {
 /**
  * Added detection to set.
  */
-void DetectionManager::addDetection(unsigned int x, unsigned int y, unsigned int size) {
+void DetectionManager::addDetection(unsigned int x, unsigned int y, unsigned int size, float margin) {
   detection_structure detection;
   detection.x = x;
   detection.y = y;
   detection.size = size;
+  detection.margin = margin;
   this->detections.push_back(detection);
 }
 
@@ -90,6 +97,119 @@ int DetectionManager::count() {
   return count;
 }
 
+/**
+ * Check, that detections are similar.
+ *
+ * Every side of one detection is not further than eps part of smaller
+ * size from the same side of another detection.
+ */
+static bool detections_are_similar(const detection_structure &first, const detection_structure &second) {
+  float delta = detection_group_eps * (first.size < second.size ? first.size : second.size);
+  return fabs((float) first.x - (float) second.x) <= delta
+    && fabs((float) first.y - (float) second.y) <= delta
+    && fabs((float) (first.x + first.size) - (float) (second.x + second.size)) <= delta
+    && fabs((float) (first.y + first.size) - (float) (second.y + second.size)) <= delta;
+}
+
+/**
+ * Get grid bucket key of detection for size class and cell offsets.
+ */
+static unsigned long long detection_bucket_key(const detection_structure &detection, int size_class, int dx, int dy) {
+  float cell = pow(1 + 2 * detection_group_eps, size_class);
+  long long x = (long long) (detection.x / cell) + dx + 1, y = (long long) (detection.y / cell) + dy + 1;
+  return ((unsigned long long) size_class << 48) | ((unsigned long long) x << 24) | (unsigned long long) y;
+}
+
+/**
+ * Find union-find set root with path halving.
+ */
+static unsigned int detection_set_root(std::vector<unsigned int> &parents, unsigned int index) {
+  while (parents[index] != index) {
+    parents[index] = parents[parents[index]];
+    index = parents[index];
+  }
+  return index;
+}
+
+/**
+ * Group similar detections, keep groups with min neighbors count.
+ *
+ * Similar detections differ in size not more than 1 + 2 * eps times, so
+ * detections are put in grid buckets by size class with cells not smaller
+ * than class sizes eps part, and every detection is compared only with
+ * detections of neighbour classes and cells. Similar detections are united
+ * in sets, group box is average of set boxes. Groups are ordered by
+ * neighbors count and confidence.
+ */
+std::vector<detection_group> DetectionManager::group(unsigned int min_neighbors) {
+  std::unordered_map<unsigned long long, std::vector<unsigned int> > buckets;
+  std::unordered_map<unsigned long long, std::vector<unsigned int> >::iterator bucket;
+  std::vector<unsigned int> parents(this->detections.size());
+  std::vector<int> size_classes(this->detections.size());
+  float class_base = log(1 + 2 * detection_group_eps);
+  unsigned int first_root, second_root;
+
+  for (unsigned int i = 0; i < this->detections.size(); i++) {
+    parents[i] = i;
+    size_classes[i] = (int) (log((float) this->detections[i].size) / class_base);
+    buckets[detection_bucket_key(this->detections[i], size_classes[i], 0, 0)].push_back(i);
+  }
+  for (unsigned int i = 0; i < this->detections.size(); i++) {
+    for (int size_class = size_classes[i] - 1; size_class <= size_classes[i] + 1; size_class++) {
+      for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+          bucket = buckets.find(detection_bucket_key(this->detections[i], size_class, dx, dy));
+          if (bucket == buckets.end()) {
+            continue;
+          }
+          for (unsigned int j = 0; j < bucket->second.size(); j++) {
+            if (bucket->second[j] <= i || !detections_are_similar(this->detections[i], this->detections[bucket->second[j]])) {
+              continue;
+            }
+            first_root = detection_set_root(parents, i);
+            second_root = detection_set_root(parents, bucket->second[j]);
+            if (first_root != second_root) {
+              parents[second_root] = first_root;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Sum boxes of every set in its root.
+  std::vector<double> sum_x(this->detections.size(), 0), sum_y(this->detections.size(), 0), sum_size(this->detections.size(), 0);
+  std::vector<detection_group> groups(this->detections.size());
+  unsigned int root;
+  for (unsigned int i = 0; i < this->detections.size(); i++) {
+    root = detection_set_root(parents, i);
+    if (groups[root].neighbors == 0 || this->detections[i].margin > groups[root].confidence) {
+      groups[root].confidence = this->detections[i].margin;
+    }
+    groups[root].neighbors++;
+    sum_x[root] += this->detections[i].x;
+    sum_y[root] += this->detections[i].y;
+    sum_size[root] += this->detections[i].size;
+  }
+  std::vector<detection_group> result;
+  for (unsigned int i = 0; i < groups.size(); i++) {
+    if (groups[i].neighbors == 0 || groups[i].neighbors < min_neighbors) {
+      continue;
+    }
+    groups[i].x = sum_x[i] / groups[i].neighbors + 0.5;
+    groups[i].y = sum_y[i] / groups[i].neighbors + 0.5;
+    groups[i].size = sum_size[i] / groups[i].neighbors + 0.5;
+    result.push_back(groups[i]);
+  }
+  std::stable_sort(result.begin(), result.end(), [](const detection_group &first, const detection_group &second) {
+    if (first.neighbors != second.neighbors) {
+      return first.neighbors > second.neighbors;
+    }
+    return first.confidence > second.confidence;
+  });
+  return result;
+}
+
 /**
  * Show detections on image.
  */
@@ -129,33 +249,79 @@ bool file_is_exist(std::string file_path) {
 
 /**
  * Give real random int from range.
+ *
+ * Generator is seeded by random device once per thread.
  */
 int random_int(int min, int max) {
-  std::random_device rd;
-  std::mt19937 gen{rd()};
-  std::uniform_int_distribution<> dis{min, max};
-  return dis(gen);
+  static thread_local std::mt19937 generator{std::random_device()()};
+  return random_int(generator, min, max);
+}
+
+/**
+ * Give random int from range by generator.
+ */
+int random_int(std::mt19937 &generator, int min, int max) {
+  std::uniform_int_distribution<> distribution{min, max};
+  return distribution(generator);
+}
+
+/**
+ * Give float in string with all its significant digits.
+ *
+ * Nine digits are enough to read the same float back.
+ */
+std::string float_to_string(float value) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.9g", value);
+  return buffer;
 }
 
 /**
  * Give pixels shade in string.
  */
 std::string image_pixels_shade_to_string(Magick::Image image) {
+  unsigned int count = image.rows() * image.columns();
+  std::vector<float> pixels(count);
+  image_pixels_shade(image, pixels.data());
+
   std::string result = "";
-  unsigned int rows = image.rows();
-  unsigned int columns = image.columns();
-  for (unsigned int x = 0; x < rows; x++) {
-    for (unsigned int y = 0; y < columns; y++) {
-      Magick::ColorGray color = image.pixelColor(x, y);
-      result += std::to_string(color.shade());
-      if (x != (rows - 1) && y != (columns - 1)) {
-        result += " ";
-      }
+  for (unsigned int i = 0; i < count; i++) {
+    result += std::to_string(pixels[i]);
+    if (i != count - 1) {
+      result += " ";
     }
   }
   return result;
 }
 
+/**
+ * Give pixels shade in buffer, row by row.
+ *
+ * Pixels are exported by one call, so there is no color object per pixel.
+ */
+void image_pixels_shade(Magick::Image image, float *pixels) {
+  image.write(0, 0, image.columns(), image.rows(), "I", Magick::FloatPixel, pixels);
+}
+
+/**
+ * Compute integral and squared integral images with zero first row and
+ * column straight from image pixels shade.
+ *
+ * Pixels are exported by bands of rows in one small buffer and streamed
+ * in fused builder, so the whole pixels shade array is never allocated.
+ */
+void image_integral_images(Magick::Image image, float *integral_image, float *squared_integral_image) {
+  unsigned int columns = image.columns(), rows = image.rows(), band_rows;
+  std::vector<float> band(image_integral_band_rows * columns);
+  IntegralImages integral_images(columns, integral_image, squared_integral_image);
+
+  for (unsigned int first_row = 0; first_row < rows; first_row += band_rows) {
+    band_rows = rows - first_row < image_integral_band_rows ? rows - first_row : image_integral_band_rows;
+    image.write(0, first_row, columns, band_rows, "I", Magick::FloatPixel, band.data());
+    integral_images.addRows(band.data(), band_rows);
+  }
+}
+
 /**
  * Crop image by min size.
  */
@@ -201,24 +367,34 @@ float* calculate_target_fpr(int cascade_steps, float common_fpr) {
  */
 float* read_sample_from_string(std::string sample_string, int w, int h) {
   float *sample = new float[w * h];
-  int x = 0, y = 0;
+  if (!parse_sample_string(sample_string, w, h, sample)) {
+    delete[] sample;
+    return NULL;
+  }
+  return sample;
+}
+
+/**
+ * Parse sample string in buffer, get false for wrong pixels count.
+ */
+bool parse_sample_string(const std::string &sample_string, int w, int h, float *sample) {
+  int WxH = w * h, index = 0;
+  const char *position = sample_string.c_str();
+  char *end;
   float value;
-  std::istringstream stream(sample_string);
 
-  while (stream >> value) {
-    if (y == h) {
-      return NULL;
+  while (true) {
+    value = strtof(position, &end);
+    if (end == position) {
+      break;
     }
-    sample[(y * w) + (x++)] = value;
-    if (x == w) {
-      x = 0;
-      y++;
+    if (index == WxH) {
+      return false;
     }
+    sample[index++] = value;
+    position = end;
   }
-  if (x != 0 || y != h) {
-    return NULL;
-  }
-  return sample;
+  return index == WxH;
 }
 
 /**
@@ -290,9 +466,104 @@ float* compute_integral_image(float *sample, int w, int h, bool squared) {
       }
     }
   }
+  delete[] safety_val;
   return integral_image;
 }
 
+/**
+ * Compute integral image with zero first row and column.
+ *
+ * Result has (w + 1) x (h + 1) size, so any rectangle sum is taken from
+ * four corners without image border checks.
+ */
+float* compute_padded_integral_image(float *sample, int w, int h, bool squared) {
+  float* integral_image = new float[(w + 1) * (h + 1)];
+  compute_padded_integral_image(sample, w, h, squared, integral_image);
+  return integral_image;
+}
+
+/**
+ * Compute integral image with zero first row and column in given buffer.
+ */
+void compute_padded_integral_image(float *sample, int w, int h, bool squared, float *integral_image) {
+  int padded_w = w + 1;
+  float row_sum;
+
+  for (int x = 0; x < padded_w; x++) {
+    integral_image[x] = 0;
+  }
+  for (int y = 0; y < h; y++) {
+    integral_image[(y + 1) * padded_w] = 0;
+    row_sum = 0;
+    for (int x = 0; x < w; x++) {
+      row_sum = squared ? row_sum + pow(sample[(y * w) + x], 2) : row_sum + sample[(y * w) + x];
+      integral_image[(y + 1) * padded_w + x + 1] = integral_image[y * padded_w + x + 1] + row_sum;
+    }
+  }
+}
+
+/**
+ * Calculate area weights of source pixels for every downsampled pixel.
+ *
+ * Downsampled pixel covers [i * factor, (i + 1) * factor) source range,
+ * weights are source pixels overlaps divided by covered length.
+ */
+static void downsample_weights(int size, float factor, int result_size, std::vector<int> &first, std::vector<int> &last, std::vector<std::vector<float> > &weights) {
+  double begin, end, overlap;
+  first.resize(result_size);
+  last.resize(result_size);
+  weights.resize(result_size);
+  for (int i = 0; i < result_size; i++) {
+    begin = i * (double) factor;
+    end = (i + 1) * (double) factor < size ? (i + 1) * (double) factor : size;
+    first[i] = (int) begin;
+    last[i] = (int) ceil(end) - 1;
+    weights[i].clear();
+    for (int j = first[i]; j <= last[i]; j++) {
+      overlap = (j + 1 < end ? j + 1 : end) - (j > begin ? j : begin);
+      weights[i].push_back(overlap / (end - begin));
+    }
+  }
+}
+
+/**
+ * Downsample pixels by factor with area averaging.
+ *
+ * Rows are reduced first by adding whole source rows, so the most work
+ * goes over contiguous memory, and columns are reduced after them. Result
+ * must have w / factor x h / factor size.
+ */
+void downsample_pixels(const float *pixels, int w, int h, float factor, float *result, int result_w, int result_h) {
+  std::vector<int> first_x, last_x, first_y, last_y;
+  std::vector<std::vector<float> > weights_x, weights_y;
+  std::vector<float> row(w);
+  const float *source_row, *weights;
+  float weight, value;
+
+  downsample_weights(w, factor, result_w, first_x, last_x, weights_x);
+  downsample_weights(h, factor, result_h, first_y, last_y, weights_y);
+  for (int y = 0; y < result_h; y++) {
+    for (int x = 0; x < w; x++) {
+      row[x] = 0;
+    }
+    for (int k = first_y[y]; k <= last_y[y]; k++) {
+      source_row = pixels + k * w;
+      weight = weights_y[y][k - first_y[y]];
+      for (int x = 0; x < w; x++) {
+        row[x] += source_row[x] * weight;
+      }
+    }
+    for (int x = 0; x < result_w; x++) {
+      weights = weights_x[x].data() - first_x[x];
+      value = 0;
+      for (int k = first_x[x]; k <= last_x[x]; k++) {
+        value += row[k] * weights[k];
+      }
+      result[y * result_w + x] = value;
+    }
+  }
+}
+
 /**
  * Rotate sample to 90 degrees.
  */
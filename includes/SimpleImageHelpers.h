@@ -16,14 +16,37 @@ limitations under the License.
 
 #include <Magick++.h>
 #include <string.h>
+#include <random>
+
+// Define samples min/max sizes.
+const int sample_min_size = 21;
+const int sample_max_size = 500;
+// Image rows count exported by one call, when integral images are computed.
+const unsigned int image_integral_band_rows = 64;
 
 // Object detection structure.
 struct detection_structure {
   unsigned int x;
   unsigned int y;
   unsigned int size;
+  // Last stage votes sum minus its limit.
+  float margin;
 };
 
+// Grouped object detection structure.
+struct detection_group {
+  unsigned int x;
+  unsigned int y;
+  unsigned int size;
+  // Count of raw detections in group.
+  unsigned int neighbors;
+  // The best last stage margin in group.
+  float confidence;
+};
+
+// Max distance between similar detections sides relative to smaller size.
+const float detection_group_eps = 0.2;
+
 /**
  * Helper feature counter class.
  */
@@ -67,9 +90,11 @@ class WeightsSum {
 class DetectionManager {
   public:
     // Added detection to set.
-    void addDetection(unsigned int x, unsigned int y, unsigned int size);
+    void addDetection(unsigned int x, unsigned int y, unsigned int size, float margin = 0);
     // Load detections count.
     int count();
+    // Group similar detections, keep groups with min neighbors count.
+    std::vector<detection_group> group(unsigned int min_neighbors);
     // Show detections on image.
     void showDetections(Magick::Image image, std::string image_file_name);
   protected:
@@ -81,20 +106,34 @@ class DetectionManager {
 bool file_is_exist(std::string file_path);
 // Give real random int from range.
 int random_int(int min, int max);
+int random_int(std::mt19937 &generator, int min, int max);
+// Give float in string with all its significant digits.
+std::string float_to_string(float value);
 // Give pixels shade in string.
 std::string image_pixels_shade_to_string(Magick::Image image);
+// Give pixels shade in buffer, row by row.
+void image_pixels_shade(Magick::Image image, float *pixels);
+// Compute integral and squared integral images with zero first row and column from image.
+void image_integral_images(Magick::Image image, float *integral_image, float *squared_integral_image);
 // Crop image by min size.
 Magick::Image image_crop_by_min_size(Magick::Image image);
 // Calculate false positive rate per step.
 float* calculate_target_fpr(int cascade_steps, float common_fpr);
 // Read sample string from file.
 float* read_sample_from_string(std::string sample_string, int w, int h);
+// Parse sample string in buffer, get false for wrong pixels count.
+bool parse_sample_string(const std::string &sample_string, int w, int h, float *sample);
 // Get normalize sample.
 float* normalize_sample(float *sample, int w, int h);
 // Mirroring samples by vertical.
 void mirroring_samples(std::vector<float*> &samples, int w, int h);
 // Compute integral image to sample.
 float* compute_integral_image(float *sample, int w, int h, bool squared);
+// Compute integral image with zero first row and column.
+float* compute_padded_integral_image(float *sample, int w, int h, bool squared);
+void compute_padded_integral_image(float *sample, int w, int h, bool squared, float *integral_image);
+// Downsample pixels by factor with area averaging.
+void downsample_pixels(const float *pixels, int w, int h, float factor, float *result, int result_w, int result_h);
 // Rotate sample to 90 degrees.
 float* sample_rotate_90(float *sample, int w, int h);
 // Calculate integral rectangle value.
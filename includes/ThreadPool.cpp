@@ -0,0 +1,185 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ThreadPool.h"
+
+/**
+ * ThreadPool constructor.
+ */
+ThreadPool::ThreadPool(unsigned int threads_count) : queues(threads_count > 0 ? threads_count : 1) {
+  this->task = NULL;
+  this->tasks_count = 0;
+  this->busy_workers = 0;
+  this->generation = 0;
+  this->failed = false;
+  this->stopping = false;
+  for (unsigned int i = 1; i < threads_count; i++) {
+    this->threads.push_back(std::thread(&ThreadPool::work, this, i));
+  }
+}
+
+/**
+ * ThreadPool destructor.
+ */
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stopping = true;
+  }
+  this->wake.notify_all();
+  for (unsigned int i = 0; i < this->threads.size(); i++) {
+    this->threads[i].join();
+  }
+}
+
+/**
+ * Get workers count.
+ */
+unsigned int ThreadPool::size() {
+  return this->threads.size() + 1;
+}
+
+/**
+ * Run tasks and wait for them, rethrow first task exception.
+ */
+void ThreadPool::run(unsigned int tasks_count, thread_pool_task task) {
+  std::lock_guard<std::mutex> run_lock(this->run_mutex);
+  std::unique_lock<std::mutex> lock(this->mutex);
+  unsigned int workers_count = this->queues.size();
+  this->task = &task;
+  this->tasks_count = tasks_count;
+  for (unsigned int i = 0; i < workers_count; i++) {
+    this->queues[i].begin = (unsigned long) tasks_count * i / workers_count;
+    this->queues[i].end = (unsigned long) tasks_count * (i + 1) / workers_count;
+  }
+  this->failed = false;
+  this->error = NULL;
+  this->busy_workers = this->threads.size();
+  this->generation++;
+  lock.unlock();
+  this->wake.notify_all();
+
+  this->execute(0);
+
+  lock.lock();
+  this->done.wait(lock, [this] { return this->busy_workers == 0; });
+  this->task = NULL;
+  if (this->error) {
+    std::exception_ptr error = this->error;
+    this->error = NULL;
+    std::rethrow_exception(error);
+  }
+}
+
+/**
+ * Worker thread loop.
+ */
+void ThreadPool::work(unsigned int worker_index) {
+  unsigned long generation = 0;
+  std::unique_lock<std::mutex> lock(this->mutex);
+  while (true) {
+    this->wake.wait(lock, [this, generation] { return this->stopping || this->generation != generation; });
+    if (this->stopping) {
+      return;
+    }
+    generation = this->generation;
+    lock.unlock();
+    this->execute(worker_index);
+    lock.lock();
+    if (--this->busy_workers == 0) {
+      this->done.notify_all();
+    }
+  }
+}
+
+/**
+ * Execute current run tasks.
+ */
+void ThreadPool::execute(unsigned int worker_index) {
+  unsigned int task_index;
+  // Skip not started tasks after first error.
+  while (!this->failed && this->takeTask(worker_index, task_index)) {
+    try {
+      (*this->task)(worker_index, task_index);
+    }
+    catch (...) {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      if (!this->error) {
+        this->error = std::current_exception();
+      }
+      this->failed = true;
+    }
+  }
+}
+
+/**
+ * Take next task from own queue or steal it from other worker.
+ */
+bool ThreadPool::takeTask(unsigned int worker_index, unsigned int &task_index) {
+  thread_pool_queue &own_queue = this->queues[worker_index];
+  unsigned int workers_count = this->queues.size(), victim_index, remaining, end;
+  {
+    std::lock_guard<std::mutex> lock(own_queue.mutex);
+    if (own_queue.begin < own_queue.end) {
+      task_index = own_queue.begin++;
+      return true;
+    }
+  }
+  while (true) {
+    // Look for the biggest remaining range.
+    victim_index = workers_count;
+    remaining = 0;
+    for (unsigned int i = 0; i < workers_count; i++) {
+      if (i != worker_index) {
+        std::lock_guard<std::mutex> lock(this->queues[i].mutex);
+        if (this->queues[i].end - this->queues[i].begin > remaining) {
+          remaining = this->queues[i].end - this->queues[i].begin;
+          victim_index = i;
+        }
+      }
+    }
+    if (victim_index == workers_count) {
+      return false;
+    }
+    thread_pool_queue &victim_queue = this->queues[victim_index];
+    {
+      std::lock_guard<std::mutex> lock(victim_queue.mutex);
+      if (victim_queue.begin == victim_queue.end) {
+        // Range was drained meanwhile, look again.
+        continue;
+      }
+      end = victim_queue.end;
+      victim_queue.end -= (victim_queue.end - victim_queue.begin + 1) / 2;
+      task_index = victim_queue.end;
+    }
+    // Keep the rest of stolen half in own queue.
+    std::lock_guard<std::mutex> lock(own_queue.mutex);
+    own_queue.begin = task_index + 1;
+    own_queue.end = end;
+    return true;
+  }
+}
+
+/**
+ * Resolve threads count, zero means all hardware threads.
+ */
+unsigned int resolve_threads_count(int threads_count) {
+  if (threads_count > 0) {
+    return threads_count;
+  }
+  unsigned int hardware_threads = std::thread::hardware_concurrency();
+  return hardware_threads > 0 ? hardware_threads : 1;
+}
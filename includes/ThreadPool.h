@@ -0,0 +1,78 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+
+// Pool task type, receives worker index and task index.
+typedef std::function<void(unsigned int, unsigned int)> thread_pool_task;
+
+// Worker tasks queue structure, holds not started tasks range.
+struct thread_pool_queue {
+  std::mutex mutex;
+  unsigned int begin;
+  unsigned int end;
+};
+
+/**
+ * Fixed size pool of worker threads.
+ *
+ * The calling thread works as worker with index 0, so a pool of size one
+ * runs everything inline. Worker index is stable during run and can be
+ * used to address per-worker scratch buffers.
+ *
+ * Tasks are split in contiguous ranges between workers. A worker, that
+ * finished own range, steals half of the biggest remaining range.
+ * Runs from different threads are serialized, a task must not call run.
+ */
+class ThreadPool {
+  public:
+    // Thread pool constructor and destructor.
+    ThreadPool(unsigned int threads_count);
+    ~ThreadPool();
+    // Get workers count.
+    unsigned int size();
+    // Run tasks and wait for them, rethrow first task exception.
+    void run(unsigned int tasks_count, thread_pool_task task);
+  protected:
+    // Worker threads set.
+    std::vector<std::thread> threads;
+    // Pool state guard and notifications.
+    std::mutex mutex, run_mutex;
+    std::condition_variable wake, done;
+    // Current run variables.
+    thread_pool_task *task;
+    unsigned int tasks_count, busy_workers;
+    unsigned long generation;
+    std::vector<thread_pool_queue> queues;
+    std::atomic<bool> failed;
+    std::exception_ptr error;
+    bool stopping;
+    // Worker thread loop.
+    void work(unsigned int worker_index);
+    // Execute current run tasks.
+    void execute(unsigned int worker_index);
+    // Take next task from own queue or steal it from other worker.
+    bool takeTask(unsigned int worker_index, unsigned int &task_index);
+};
+
+// Resolve threads count, zero means all hardware threads.
+unsigned int resolve_threads_count(int threads_count);
@@ -0,0 +1,250 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <phpcpp.h>
+#include <string.h>
+#include <stdio.h>
+#include <vector>
+#include <fstream>
+#include "SimpleImageHelpers.h"
+#include "HaarFeature.h"
+#include "WeaklyClassifier.h"
+#include "ForcefulClassifier.h"
+#include "CascadeClassifier.h"
+#include "CompiledCascade.h"
+#include "SamplePool.h"
+#include "ModelLoader.h"
+#include "TrainingCheckpoint.h"
+
+// Stage record of checkpoint cascade.
+struct checkpoint_stage {
+  unsigned int weakly_count;
+  float limit;
+};
+
+// Weakly classifier record of checkpoint cascade.
+struct checkpoint_weakly {
+  float weight;
+  int feature_type;
+  int x;
+  int y;
+  int w;
+  int h;
+  float limit;
+  int state;
+  // Lookup table bin width and bins count, values follow the record.
+  float bin_width;
+  unsigned int bins_count;
+  // Soft cascade rejection limit.
+  float rejection;
+};
+
+/**
+ * Continue checksum calculation by data.
+ */
+static unsigned int checkpoint_checksum(unsigned int checksum, const char *data, size_t data_size) {
+  for (size_t i = 0; i < data_size; i++) {
+    checksum = (checksum ^ (unsigned char) data[i]) * 16777619u;
+  }
+  return checksum;
+}
+
+/**
+ * Write data in checkpoint file and add it to checksum.
+ */
+static void checkpoint_write(std::ofstream &file, unsigned int &checksum, const void *data, size_t data_size) {
+  file.write((const char*) data, data_size);
+  checksum = checkpoint_checksum(checksum, (const char*) data, data_size);
+}
+
+/**
+ * Save training checkpoint, file is replaced at once.
+ *
+ * Cascade is kept in binary form with lookup tables and rejection limits
+ * as they are, so resumed training uses exactly the same values.
+ * File is written next to target and renamed, so killed process never
+ * leaves broken checkpoint.
+ */
+bool save_training_checkpoint(std::string file_name, training_checkpoint_state &state, CascadeClassifier *cascade_classifier, SamplePool &positive_pool, SamplePool &negative_pool) {
+  std::vector<ForcefulClassifier*> forceful_classifiers = cascade_classifier->getForcefulClassifiers();
+  std::vector<WeaklyClassifier*> weakly_classifiers;
+  std::vector<float> weights, table, rejections;
+  size_t integral_size = (size_t) (state.size + 1) * (state.size + 1) * sizeof(float);
+  std::string temp_file_name = file_name + ".tmp";
+  training_checkpoint_header header;
+  checkpoint_stage stage;
+  checkpoint_weakly weakly;
+  HaarFeature *feature;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "SIMGCKPT", 8);
+  header.version = training_checkpoint_version;
+  header.size = state.size;
+  header.steps_done = state.steps_done;
+  header.cascade_steps = state.cascade_steps;
+  header.negative_samples_per_step = state.negative_samples_per_step;
+  header.positive_count = positive_pool.size();
+  header.negative_count = negative_pool.size();
+  header.negative_position = state.negative_position;
+  header.negative_source = state.negative_source;
+  header.soft = cascade_classifier->isSoft();
+  header.checksum = 2166136261u;
+
+  std::ofstream file(temp_file_name, std::ios::binary);
+  file.write((const char*) &header, sizeof(header));
+  stage.weakly_count = forceful_classifiers.size();
+  checkpoint_write(file, header.checksum, &stage.weakly_count, sizeof(stage.weakly_count));
+  for (unsigned int i = 0; i < forceful_classifiers.size(); i++) {
+    weakly_classifiers = forceful_classifiers[i]->getWeaklyClassifiers();
+    weights = forceful_classifiers[i]->getWeights();
+    rejections = forceful_classifiers[i]->getRejections();
+    memset(&stage, 0, sizeof(stage));
+    stage.weakly_count = weakly_classifiers.size();
+    stage.limit = forceful_classifiers[i]->getLimit();
+    checkpoint_write(file, header.checksum, &stage, sizeof(stage));
+    for (unsigned int j = 0; j < weakly_classifiers.size(); j++) {
+      feature = weakly_classifiers[j]->getFeature();
+      table = weakly_classifiers[j]->getTable();
+      memset(&weakly, 0, sizeof(weakly));
+      weakly.weight = weights[j];
+      weakly.feature_type = feature->type();
+      weakly.x = feature->left();
+      weakly.y = feature->top();
+      weakly.w = feature->width();
+      weakly.h = feature->height();
+      weakly.limit = weakly_classifiers[j]->getLimit();
+      weakly.state = weakly_classifiers[j]->getState();
+      weakly.bin_width = weakly_classifiers[j]->getBinWidth();
+      weakly.bins_count = table.size();
+      weakly.rejection = j < rejections.size() ? rejections[j] : 0;
+      checkpoint_write(file, header.checksum, &weakly, sizeof(weakly));
+      checkpoint_write(file, header.checksum, table.data(), table.size() * sizeof(float));
+      header.weakly_count++;
+      header.table_count += table.size();
+    }
+  }
+  for (unsigned int i = 0; i < positive_pool.size(); i++) {
+    checkpoint_write(file, header.checksum, positive_pool.sample(i), integral_size);
+  }
+  for (unsigned int i = 0; i < negative_pool.size(); i++) {
+    checkpoint_write(file, header.checksum, negative_pool.sample(i), integral_size);
+  }
+  file.seekp(0);
+  file.write((const char*) &header, sizeof(header));
+  file.close();
+  if (file.fail()) {
+    remove(temp_file_name.c_str());
+    return false;
+  }
+  return rename(temp_file_name.c_str(), file_name.c_str()) == 0;
+}
+
+/**
+ * Load training checkpoint in samples pools, get partial cascade classifier.
+ */
+CascadeClassifier* load_training_checkpoint(std::string file_name, training_checkpoint_state &state, SamplePool &positive_pool, SamplePool &negative_pool) {
+  std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    throw Php::Exception("Simple Image: Checkpoint file not exist");
+  }
+  std::vector<char> data(file.tellg());
+  file.seekg(0);
+  file.read(data.data(), data.size());
+  if (!file || data.size() < sizeof(training_checkpoint_header) + sizeof(unsigned int)) {
+    throw Php::Exception("Simple Image: Wrong checkpoint format");
+  }
+
+  training_checkpoint_header header;
+  memcpy(&header, data.data(), sizeof(header));
+  const char *position = data.data() + sizeof(header), *end = data.data() + data.size();
+  size_t integral_size = (size_t) (header.size + 1) * (header.size + 1) * sizeof(float);
+  unsigned int stages_count;
+  memcpy(&stages_count, position, sizeof(stages_count));
+  if (memcmp(header.magic, "SIMGCKPT", 8) != 0 || header.version != training_checkpoint_version
+      || header.size < sample_min_size || header.size > sample_max_size
+      || header.negative_source > training_negative_background_images
+      || (size_t) (end - position) != sizeof(stages_count) + (size_t) stages_count * sizeof(checkpoint_stage) + (size_t) header.weakly_count * sizeof(checkpoint_weakly) + (size_t) header.table_count * sizeof(float)
+        + ((size_t) header.positive_count + header.negative_count) * integral_size
+      || checkpoint_checksum(2166136261u, position, end - position) != header.checksum) {
+    throw Php::Exception("Simple Image: Wrong checkpoint format");
+  }
+  if (header.size != positive_pool.sampleSize() || header.size != negative_pool.sampleSize()) {
+    throw Php::Exception("Simple Image: Checkpoint has other samples size");
+  }
+  position += sizeof(stages_count);
+
+  // Restore cascade classifier with own features.
+  CascadeClassifier *cascade_classifier = new CascadeClassifier(header.size);
+  cascade_classifier->setSoft(header.soft != 0);
+  ForcefulClassifier *forceful_classifier;
+  checkpoint_stage stage;
+  checkpoint_weakly weakly;
+  std::vector<float> table, rejections;
+  unsigned int weakly_left = header.weakly_count, table_left = header.table_count;
+  for (unsigned int i = 0; i < stages_count; i++) {
+    memcpy(&stage, position, sizeof(stage));
+    position += sizeof(stage);
+    if (stage.weakly_count > weakly_left) {
+      destroy_cascade_classifier(cascade_classifier);
+      throw Php::Exception("Simple Image: Wrong checkpoint format");
+    }
+    weakly_left -= stage.weakly_count;
+    forceful_classifier = new ForcefulClassifier(std::vector<WeaklyClassifier*>(), NULL, stage.limit);
+    cascade_classifier->addClassifier(forceful_classifier);
+    rejections.clear();
+    for (unsigned int j = 0; j < stage.weakly_count; j++) {
+      memcpy(&weakly, position, sizeof(weakly));
+      position += sizeof(weakly);
+      rejections.push_back(weakly.rejection);
+      if (weakly.bins_count > table_left) {
+        destroy_cascade_classifier(cascade_classifier);
+        throw Php::Exception("Simple Image: Wrong checkpoint format");
+      }
+      if (weakly.bins_count == 0) {
+        forceful_classifier->addClassifier(new WeaklyClassifier(new HaarFeature(weakly.feature_type, weakly.x, weakly.y, weakly.w, weakly.h), weakly.limit, weakly.state != 0), weakly.weight);
+      }
+      else {
+        // Lookup table values follow weakly classifier record.
+        table.resize(weakly.bins_count);
+        memcpy(table.data(), position, table.size() * sizeof(float));
+        position += table.size() * sizeof(float);
+        table_left -= table.size();
+        forceful_classifier->addClassifier(new WeaklyClassifier(new HaarFeature(weakly.feature_type, weakly.x, weakly.y, weakly.w, weakly.h), weakly.limit, weakly.bin_width, table), weakly.weight);
+      }
+    }
+    if (header.soft) {
+      forceful_classifier->setRejections(rejections);
+    }
+  }
+
+  // Restore samples integral images.
+  positive_pool.reserve(header.positive_count);
+  for (unsigned int i = 0; i < header.positive_count; i++, position += integral_size) {
+    positive_pool.addIntegralImage((const float*) position);
+  }
+  negative_pool.reserve(header.negative_count);
+  for (unsigned int i = 0; i < header.negative_count; i++, position += integral_size) {
+    negative_pool.addIntegralImage((const float*) position);
+  }
+
+  state.size = header.size;
+  state.steps_done = header.steps_done;
+  state.cascade_steps = header.cascade_steps;
+  state.negative_samples_per_step = header.negative_samples_per_step;
+  state.negative_position = header.negative_position;
+  state.negative_source = header.negative_source;
+  return cascade_classifier;
+}
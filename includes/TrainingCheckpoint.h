@@ -0,0 +1,69 @@
+/*
+Copyright © 2017 Andrey Tymchuk.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+  http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <string>
+
+// Training checkpoint file format version.
+const unsigned int training_checkpoint_version = 4;
+// Negative samples sources, position is byte offset in samples file
+// or visit index of background images.
+const unsigned int training_negative_samples_file = 0;
+const unsigned int training_negative_background_images = 1;
+
+// Training checkpoint file header, cascade and samples integral images follow it.
+struct training_checkpoint_header {
+  // File signature "SIMGCKPT".
+  char magic[8];
+  // Format version.
+  unsigned int version;
+  // Samples size.
+  int size;
+  // Trained and all cascade steps count.
+  int steps_done;
+  int cascade_steps;
+  // Negative samples per training step.
+  unsigned int negative_samples_per_step;
+  // Positive and negative samples count.
+  unsigned int positive_count;
+  unsigned int negative_count;
+  // Weakly classifiers count over all stages.
+  unsigned int weakly_count;
+  // Negative samples file reading position.
+  unsigned long long negative_position;
+  // Checksum of all data after header.
+  unsigned int checksum;
+  // Lookup tables values count over all weakly classifiers.
+  unsigned int table_count;
+  // Soft cascade flag.
+  unsigned int soft;
+  // Negative samples source of reading position.
+  unsigned int negative_source;
+};
+
+// Training state kept in checkpoint.
+struct training_checkpoint_state {
+  int size;
+  int steps_done;
+  int cascade_steps;
+  unsigned int negative_samples_per_step;
+  unsigned long long negative_position;
+  unsigned int negative_source;
+};
+
+// Save training checkpoint, file is replaced at once.
+bool save_training_checkpoint(std::string file_name, training_checkpoint_state &state, CascadeClassifier *cascade_classifier, SamplePool &positive_pool, SamplePool &negative_pool);
+// Load training checkpoint in samples pools, get partial cascade classifier.
+CascadeClassifier* load_training_checkpoint(std::string file_name, training_checkpoint_state &state, SamplePool &positive_pool, SamplePool &negative_pool);
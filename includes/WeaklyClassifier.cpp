@@ -16,6 +16,7 @@ limitations under the License.
 
 #include <string.h>
 #include <math.h>
+#include <vector>
 #include <algorithm>
 #include "SimpleImageHelpers.h"
 #include "HaarFeature.h"
@@ -33,6 +34,8 @@ static bool feature_counters_compare(FeatureCounter &a, FeatureCounter &b) {
  */
 WeaklyClassifier::WeaklyClassifier(HaarFeature *feature) {
   this->feature = feature;
+  this->bin_width = 0;
+  this->owns_feature = false;
 }
 
 /**
@@ -42,6 +45,40 @@ WeaklyClassifier::WeaklyClassifier(HaarFeature *feature, float limit, bool state
   this->feature = feature;
   this->limit = limit;
   this->state = state;
+  this->bin_width = 0;
+  this->owns_feature = false;
+}
+
+/**
+ * WeaklyClassifier lookup table constructor.
+ */
+WeaklyClassifier::WeaklyClassifier(HaarFeature *feature, float limit, float bin_width, std::vector<float> table) {
+  this->feature = feature;
+  this->limit = limit;
+  this->state = false;
+  this->bin_width = bin_width;
+  this->table = table;
+  this->owns_feature = false;
+}
+
+/**
+ * WeaklyClassifier destructor.
+ */
+WeaklyClassifier::~WeaklyClassifier() {
+  if (this->owns_feature) {
+    delete this->feature;
+  }
+}
+
+/**
+ * Create deep classifier copy, which owns feature copy.
+ */
+WeaklyClassifier* WeaklyClassifier::copy() {
+  WeaklyClassifier *result = new WeaklyClassifier(this->feature->copy(), this->limit, this->state);
+  result->bin_width = this->bin_width;
+  result->table = this->table;
+  result->owns_feature = true;
+  return result;
 }
 
 /**
@@ -51,12 +88,48 @@ HaarFeature* WeaklyClassifier::getFeature() {
   return this->feature;
 }
 
+/**
+ * Get classifier limit.
+ */
+float WeaklyClassifier::getLimit() {
+  return this->limit;
+}
+
+/**
+ * Get classifier state.
+ */
+bool WeaklyClassifier::getState() {
+  return this->state;
+}
+
+/**
+ * Check, that classifier is lookup table.
+ */
+bool WeaklyClassifier::isTable() {
+  return !this->table.empty();
+}
+
+/**
+ * Get lookup table bin width.
+ */
+float WeaklyClassifier::getBinWidth() {
+  return this->bin_width;
+}
+
+/**
+ * Get lookup table values.
+ */
+std::vector<float> WeaklyClassifier::getTable() {
+  return this->table;
+}
+
 /**
  * Scale classifier feature by value.
  */
 void WeaklyClassifier::scaleByValue(float value) {
-  // Scale classifier limit.
+  // Scale classifier limit and bin width.
   this->limit *= pow(value, 2);
+  this->bin_width *= pow(value, 2);
   // Scale classifier feature.
   this->feature->scaleByValue(value);
 }
@@ -128,10 +201,107 @@ float WeaklyClassifier::calculateLimit(float *values, int size1, int size2, floa
   return min_error;
 }
 
+/**
+ * Calculate classifier limit by presorted feature values.
+ *
+ * Values are sorted once per cascade step, so each boosting round needs
+ * only one weighted linear scan. Samples indexes below size1 are positive.
+ */
+float WeaklyClassifier::calculateLimit(float *sorted_values, unsigned int *sorted_indexes, unsigned int size1, unsigned int sizes_sum, float *weights, float positive_sum, float negative_sum) {
+  float min_error = 1, error1, error2, positive = 0, negative = 0;
+  unsigned int index;
+
+  for (unsigned int i = 0; i < sizes_sum; i++) {
+    index = sorted_indexes[i];
+    if (index < size1) {
+      positive += weights[index];
+    }
+    else {
+      negative += weights[index];
+    }
+    error1 = positive + negative_sum - negative;
+    error2 = negative + positive_sum - positive;
+    if (error1 < error2) {
+      if (error1 < min_error) {
+        min_error = error1;
+        this->limit = sorted_values[i];
+        this->state = false;
+      }
+    }
+    else {
+      if (error2 < min_error) {
+        min_error = error2;
+        this->limit = sorted_values[i];
+        this->state = true;
+      }
+    }
+  }
+  return min_error;
+}
+
+/**
+ * Calculate lookup table by presorted feature values.
+ *
+ * Values range is split in bins of equal width. Real AdaBoost bin value is
+ * half of log ratio of positive and negative weights in bin and classifier
+ * is scored by normalization factor Z. Gentle AdaBoost bin value is weighted
+ * mean of labels in bin and classifier is scored by weighted squared error.
+ * Score of classifier, which can not split values, is 1.
+ */
+float WeaklyClassifier::calculateTable(float *sorted_values, unsigned int *sorted_indexes, unsigned int size1, unsigned int sizes_sum, float *weights, bool gentle) {
+  float positive[weakly_table_bins], negative[weakly_table_bins], smoothing = 1 / float(sizes_sum), result = 0;
+  unsigned int index, bin;
+
+  this->limit = sorted_values[0];
+  this->bin_width = (sorted_values[sizes_sum - 1] - sorted_values[0]) / weakly_table_bins;
+  this->table.assign(weakly_table_bins, 0);
+  if (!(this->bin_width > 0)) {
+    return 1;
+  }
+  for (unsigned int i = 0; i < weakly_table_bins; i++) {
+    positive[i] = negative[i] = 0;
+  }
+  for (unsigned int i = 0; i < sizes_sum; i++) {
+    index = sorted_indexes[i];
+    bin = WeaklyClassifier::tableBin(sorted_values[i], this->limit, this->bin_width, weakly_table_bins);
+    if (index < size1) {
+      positive[bin] += weights[index];
+    }
+    else {
+      negative[bin] += weights[index];
+    }
+  }
+  for (unsigned int i = 0; i < weakly_table_bins; i++) {
+    if (gentle) {
+      if (positive[i] + negative[i] > 0) {
+        this->table[i] = (positive[i] - negative[i]) / (positive[i] + negative[i]);
+      }
+      result += positive[i] + negative[i] - (positive[i] - negative[i]) * this->table[i];
+    }
+    else {
+      this->table[i] = 0.5 * log((positive[i] + smoothing) / (negative[i] + smoothing));
+      result += 2 * sqrt(positive[i] * negative[i]);
+    }
+  }
+  return result;
+}
+
+/**
+ * Get lookup table bin of feature value.
+ *
+ * Values out of table range get first or last bin.
+ */
+unsigned int WeaklyClassifier::tableBin(float value, float limit, float bin_width, unsigned int bins_count) {
+  float bin = floorf((value - limit) / bin_width), last_bin = bins_count - 1;
+  bin = bin > 0 ? bin : 0;
+  bin = bin < last_bin ? bin : last_bin;
+  return bin;
+}
+
 /**
  * Classify image by classifier.
  */
-int WeaklyClassifier::classifyImage(float *image, int image_width, int x, int y, float temp1, float temp2) {
+float WeaklyClassifier::classifyImage(float *image, int image_width, int x, int y, float temp1, float temp2) {
   // Calculate feature value.
   HaarFeature *classifier_feature = this->feature;
   float feature_value = classifier_feature->value(image, image_width, x, y);
@@ -144,6 +314,9 @@ int WeaklyClassifier::classifyImage(float *image, int image_width, int x, int y,
   if (temp2 != 0) {
     feature_value = feature_value / temp2;
   }
+  if (!this->table.empty()) {
+    return this->table[WeaklyClassifier::tableBin(feature_value, this->limit, this->bin_width, this->table.size())];
+  }
   if (feature_value < this->limit) {
     return this->state ? 1 : -1;
   }
@@ -156,6 +329,14 @@ int WeaklyClassifier::classifyImage(float *image, int image_width, int x, int y,
  * Transform classifier to string representation.
  */
 std::string WeaklyClassifier::toString() {
-  std::string result = this->feature->toString() + " " + std::to_string(this->limit);
+  std::string result = this->feature->toString() + " " + float_to_string(this->limit);
+  if (!this->table.empty()) {
+    // Lookup table state is 2, bin width, bins count and values follow it.
+    result += " 2 " + float_to_string(this->bin_width) + " " + std::to_string(this->table.size());
+    for (unsigned int i = 0; i < this->table.size(); i++) {
+      result += " " + float_to_string(this->table[i]);
+    }
+    return result;
+  }
   return this->state ? result + " 1" : result + " 0";
 }
@@ -14,29 +14,61 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+// Bins count of lookup table weakly classifier.
+const unsigned int weakly_table_bins = 16;
+
 /**
  * Class for weakly classifier.
+ *
+ * Threshold classifier votes by one limit with -1 or 1. Lookup table
+ * classifier splits feature values range, which starts from limit, in bins
+ * of equal width and votes by real value of bin.
  */
 class WeaklyClassifier {
   public:
     // Weakly classifier constructors.
     WeaklyClassifier(HaarFeature *feature);
     WeaklyClassifier(HaarFeature *feature, float limit, bool state);
+    WeaklyClassifier(HaarFeature *feature, float limit, float bin_width, std::vector<float> table);
+    ~WeaklyClassifier();
+    // Create deep classifier copy, which owns feature copy.
+    WeaklyClassifier* copy();
     // Get classifier feature.
     HaarFeature* getFeature();
+    // Get classifier limit.
+    float getLimit();
+    // Get classifier state.
+    bool getState();
+    // Check, that classifier is lookup table.
+    bool isTable();
+    // Get lookup table bin width.
+    float getBinWidth();
+    // Get lookup table values.
+    std::vector<float> getTable();
     // Scale classifier feature by value.
     void scaleByValue(float value);
     // Calculate classifier limit.
     float calculateLimit(float *values, int size1, int size2, float *weights);
+    // Calculate classifier limit by presorted feature values.
+    float calculateLimit(float *sorted_values, unsigned int *sorted_indexes, unsigned int size1, unsigned int sizes_sum, float *weights, float positive_sum, float negative_sum);
+    // Calculate lookup table by presorted feature values, for Real or Gentle AdaBoost.
+    float calculateTable(float *sorted_values, unsigned int *sorted_indexes, unsigned int size1, unsigned int sizes_sum, float *weights, bool gentle);
+    // Get lookup table bin of feature value.
+    static unsigned int tableBin(float value, float limit, float bin_width, unsigned int bins_count);
     // Classify image by classifier.
-    int classifyImage(float *image, int image_width, int x, int y, float temp1, float temp2);
+    float classifyImage(float *image, int image_width, int x, int y, float temp1, float temp2);
     // Transform classifier to string representation.
     std::string toString();
   protected:
     // Classifier state variable.
     bool state;
-    // Classifier limit variable.
+    // Classifier limit variable, first bin start for lookup table.
     float limit;
+    // Lookup table bin width and values, table is empty for threshold classifier.
+    float bin_width;
+    std::vector<float> table;
     // Classifier Haar feature.
     HaarFeature *feature;
+    // Feature is owned by classifier and removed with it.
+    bool owns_feature;
 };
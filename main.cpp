@@ -20,6 +20,9 @@ limitations under the License.
 #include <vector>        // Library for work with vectors.
 #include <fstream>       // Library for work with file streams.
 #include <sstream>       // Library for work with string streams.
+#include <algorithm>     // Library for work with ranges.
+#include <map>           // Library for work with maps.
+#include <mutex>         // Library for work with mutexes.
 #include <stdlib.h>      // Standart C++ library.
 #include <iostream>
 
@@ -28,199 +31,128 @@ limitations under the License.
 #include "includes/WeaklyClassifier.h"        // WeaklyClassifierr class definition.
 #include "includes/ForcefulClassifier.h"      // ForcefulClassifier class definition.
 #include "includes/CascadeClassifier.h"       // CascadeClassifier class definition.
+#include "includes/ThreadPool.h"              // ThreadPool class definition.
+#include "includes/FeatureResponseStore.h"    // FeatureResponseStore class definition.
+#include "includes/CompiledCascade.h"         // CompiledCascade class definition.
+#include "includes/ScaledCascade.h"           // ScaledCascade class definition.
+#include "includes/DetectionEngine.h"         // DetectionEngine class definition.
+#include "includes/IntegralImages.h"          // IntegralImages class definition.
+#include "includes/PyramidDetectionEngine.h"  // PyramidDetectionEngine class definition.
+#include "includes/DetectionPipeline.h"       // DetectionPipeline class definition.
+#include "includes/ModelCache.h"              // ModelCache class definition.
+#include "includes/SampleStore.h"             // SampleReader and SampleWriter classes definitions.
+#include "includes/SamplePool.h"              // SamplePool class definition.
+#include "includes/ModelLoader.h"             // Model files loading functions.
+#include "includes/AdaBoost.h"                // AdaBoost training functions.
+#include "includes/TrainingCheckpoint.h"      // Training checkpoint functions.
+#include "includes/NegativeMiner.h"           // NegativeMiner class definition.
+#include "includes/BackgroundMiner.h"         // BackgroundMiner class definition.
+#include "includes/SampleAugmentation.h"      // Samples augmentation kernels.
+#include "includes/SampleGenerator.h"         // SampleGenerator class definition.
+#include "includes/PositiveAugmenter.h"       // PositiveAugmenter class definition.
 
 using namespace std;     // C++ standard namespace.
 using namespace Magick;  // Magick namespace.
 
 // Helpful variable used with readdir function.
 unsigned char is_file = 0x8;
-// Define samples min/max sizes.
-const int sample_min_size = 21;
-const int sample_max_size = 500;
 
 /**
- * Load cascade classifier from text file.
+ * Get models cache, it is kept between calls.
  */
-CascadeClassifier* load_cascade_classifier_from_file(string file_name) {
-  if (!file_is_exist(file_name)) {
-    throw Php::Exception("Simple Image: Classifier file not exist");
-  }
-
-  ifstream file(file_name);
-  HaarFeature *feature;
-  vector<WeaklyClassifier*> *weakly_classifiers;
-  vector<ForcefulClassifier*> forceful_classifiers;
-  WeaklyClassifier *weakly_classifier;
-  ForcefulClassifier *forceful_classifier;
-  unsigned int forceful_count, weakly_count;
-  int size, feature_type, x, y, w, h, state, index;
-  float forceful_limit, weakly_limit, *weights;
-
-  file >> size >> forceful_count;
-  while (forceful_classifiers.size() < forceful_count) {
-    file >> weakly_count >> forceful_limit;
-    weights = new float[weakly_count];
-    weakly_classifiers = new vector<WeaklyClassifier*>();
-    index = 0;
-    while (weakly_classifiers->size() < weakly_count) {
-      file >> weights[index++] >> feature_type >> w >> h >> x >> y >> weakly_limit >> state;
-      feature = new HaarFeature(feature_type, x, y, w, h);
-      weakly_classifier = new WeaklyClassifier(feature, weakly_limit, (bool) state);
-      weakly_classifiers->push_back(weakly_classifier);
-    }
-    forceful_classifier = new ForcefulClassifier(*weakly_classifiers, weights, forceful_limit);
-    forceful_classifiers.push_back(forceful_classifier);
-  }
-
-  if (forceful_classifiers.empty() || size < sample_min_size || size > sample_max_size) {
-    throw Php::Exception("Simple Image: Wrong classifier format");
-  }
-  return new CascadeClassifier(forceful_classifiers, size);
+ModelCache* model_cache() {
+  static ModelCache cache(load_compiled_cascade_from_file);
+  return &cache;
 }
 
 /**
- * AdaBoost algorithm function.
+ * Get detection thread pool of threads count, it is kept between calls.
+ *
+ * Pools are never destroyed, as other callers may still run tasks on them,
+ * so alternating threads counts reuse already started workers.
  */
-ForcefulClassifier* ada_boost(CascadeClassifier *cascade_classifier, vector<HaarFeature*> &haar_features, vector<float*> &positive_samples, vector<float*> &negative_samples, float fpr, float fnr, int size) {
-  WeaklyClassifier *prime_weakly_classifier, *weakly_classifier;
-  ForcefulClassifier *forceful_classifier = new ForcefulClassifier();
-  unsigned int positive_size = positive_samples.size(), negative_size = negative_samples.size(), sizes_sum = positive_size + negative_size;
-  float weights_sum, minimal_error, weakly_classifier_error, classifier_fpr = 1.0, temp;
-  float *weights = new float[sizes_sum];
-  float *feature_values = new float[sizes_sum];
-
-  for (unsigned int i = 0; i < positive_size; i++) {
-    weights[i] = 1 / float(2 * positive_size);
+ThreadPool* detection_thread_pool(unsigned int threads_count) {
+  static std::mutex mutex;
+  static std::map<unsigned int, ThreadPool*> thread_pools;
+  std::lock_guard<std::mutex> lock(mutex);
+  ThreadPool *&thread_pool = thread_pools[threads_count];
+  if (thread_pool == NULL) {
+    thread_pool = new ThreadPool(threads_count);
   }
-  for (unsigned int i = 0; i < negative_size; i++) {
-    weights[positive_size + i] = 1 / float(2 * negative_size);
+  return thread_pool;
+}
+
+/**
+ * Initialize Magick++ once per process.
+ */
+void initialize_magick() {
+  static bool initialized = false;
+  if (!initialized) {
+    InitializeMagick("");
+    initialized = true;
   }
+}
 
-  while (classifier_fpr > fpr) {
-    // Stop adding new weakly classifiers after all negative samples are correctly classified.
-    if (forceful_classifier->calculateFpr(negative_samples, size) == 0) {
-      break;
+/**
+ * Read positive samples augmentation spec from array.
+ *
+ * Get false for empty array. Options are count, rotation, scale, shift,
+ * blur, noise, mirroring and seed, all of them are zero by default.
+ */
+bool read_augmentation_spec(Php::Value value, augmentation_spec &spec) {
+  spec.count = 0;
+  spec.rotation = spec.scale = spec.shift = spec.blur = spec.noise = 0;
+  spec.mirroring = false;
+  spec.seed = 0;
+  bool found = false;
+  string key;
+  double temp_double;
+  for (auto &iterator : value) {
+    key = iterator.first.stringValue();
+    temp_double = iterator.second;
+    if (temp_double < 0) {
+      throw Php::Exception("Simple Image: Augmentation option " + key + " must be greater than or equal to zero");
     }
-
-    // Normalize weights for current i.
-    weights_sum = 0;
-    for (unsigned int i = 0; i < sizes_sum; i++) {
-      weights_sum += weights[i];
+    if (key == "count") {
+      spec.count = temp_double;
     }
-    for (unsigned int i = 0; i < sizes_sum; i++) {
-      weights[i] = weights[i] / weights_sum;
+    else if (key == "rotation") {
+      spec.rotation = temp_double;
     }
-
-    // Select prime weakly classifier.
-    minimal_error = 1;
-    prime_weakly_classifier = NULL;
-    for (vector<HaarFeature*>::iterator feature_iterator = haar_features.begin(); feature_iterator != haar_features.end(); feature_iterator++) {
-      weakly_classifier = new WeaklyClassifier(*feature_iterator);
-      for (unsigned int i = 0; i < positive_size; i++) {
-        feature_values[i] = (*feature_iterator)->value(positive_samples[i], size, 0, 0);
-      }
-      for (unsigned int i = 0; i < negative_size; i++) {
-        feature_values[positive_size + i] = (*feature_iterator)->value(negative_samples[i], size, 0, 0);
-      }
-      weakly_classifier_error = weakly_classifier->calculateLimit(feature_values, positive_size, negative_size, weights);
-      if (weakly_classifier_error < minimal_error) {
-        delete prime_weakly_classifier;
-        prime_weakly_classifier = weakly_classifier;
-        minimal_error = weakly_classifier_error;
-      }
-      else {
-        delete weakly_classifier;
-      }
+    else if (key == "scale") {
+      spec.scale = temp_double;
     }
-
-    // Update weights array.
-    temp = minimal_error / (1 - minimal_error);
-    for (unsigned int i = 0; i < positive_size; i++) {
-      if (prime_weakly_classifier->classifyImage(positive_samples[i], size, 0, 0, 0, 1) == 1) {
-        weights[i] = weights[i] * temp;
-      }
+    else if (key == "shift") {
+      spec.shift = temp_double;
     }
-    for (unsigned int i = 0; i < negative_size; i++) {
-      if (prime_weakly_classifier->classifyImage(negative_samples[i], size, 0, 0, 0, 1) == -1) {
-        weights[positive_size + i] = weights[positive_size + i] * temp;
-      }
+    else if (key == "blur") {
+      spec.blur = temp_double;
     }
-
-    // Update current FPR.
-    forceful_classifier->addClassifier(prime_weakly_classifier, log(1 / temp));
-    forceful_classifier->calculateLimit(positive_samples, size, fnr);
-    classifier_fpr = forceful_classifier->calculateFpr(negative_samples, size);
-  }
-  delete[] weights;
-  delete[] feature_values;
-
-  return forceful_classifier;
-}
-
-/**
- * Create Haar features set by samples sizes.
- */
-vector<HaarFeature*> create_haar_features(int w, int h) {
-  vector<HaarFeature*> result;
-  HaarFeature *feature;
-  int x, y, feature_min_w, feature_w, feature_h;
-
-  // We have 4 features types.
-  for (int feature_type = 0; feature_type < 4; feature_type++) {
-    x = y = 0;
-    if (feature_type != 2) {
-      feature_min_w = feature_w = 4;
+    else if (key == "noise") {
+      spec.noise = temp_double;
     }
-    else {
-      feature_min_w = feature_w = 3;
+    else if (key == "mirroring") {
+      spec.mirroring = temp_double != 0;
     }
-    if (feature_type != 3) {
-      feature_h = 4;
+    else if (key == "seed") {
+      spec.seed = temp_double;
     }
     else {
-      feature_h = 3;
-    }
-    while (feature_h <= h) {
-      while (feature_w <= w) {
-        while (y + feature_h <= h) {
-          while (x + feature_w <= w) {
-            feature = new HaarFeature(feature_type, x, y, feature_w, feature_h);
-            result.push_back(feature);
-            x++;
-          }
-          x = 0;
-          y++;
-        }
-        y = 0;
-        switch (feature_type) {
-          case 0:
-            feature_w += 2;
-            break;
-          case 2:
-            feature_w += 3;
-            break;
-          default:
-            feature_w++;
-        }
-      }
-      feature_w = feature_min_w;
-      switch (feature_type) {
-        case 1:
-          feature_h += 2;
-          break;
-        case 3:
-          feature_h += 3;
-          break;
-        default:
-          feature_h++;
-      }
+      throw Php::Exception("Simple Image: Unknown augmentation option " + key);
     }
+    found = true;
   }
-  return result;
+  if (found && spec.scale >= 1) {
+    throw Php::Exception("Simple Image: Augmentation scale must be less than one");
+  }
+  return found;
 }
 
 /**
  * Train cascade by positive and negative samples.
+ *
+ * Negative samples are read from samples file or, when array of images
+ * files is given instead of file, mined from these background images.
  */
 void simple_image_train_cascade(Php::Parameters &params) {
   // Try get train params from function params.
@@ -232,9 +164,26 @@ void simple_image_train_cascade(Php::Parameters &params) {
     throw Php::Exception("Simple Image: Positive samples file not exist");
   }
   // Negative file path.
-  string negative_file_name = params[2];
-  if (!file_is_exist(negative_file_name)) {
-    throw Php::Exception("Simple Image: Negative samples file not exist");
+  // Array of background images files instead of file means mining
+  // negative samples from images.
+  string negative_file_name;
+  std::vector<string> background_files;
+  if (params[2].isArray()) {
+    for (auto &iterator : params[2]) {
+      background_files.push_back(iterator.second.stringValue());
+      if (!file_is_exist(background_files.back())) {
+        throw Php::Exception("Simple Image: Background image file not exist");
+      }
+    }
+    if (background_files.empty()) {
+      throw Php::Exception("Simple Image: Empty background images set");
+    }
+  }
+  else {
+    negative_file_name = params[2].stringValue();
+    if (!file_is_exist(negative_file_name)) {
+      throw Php::Exception("Simple Image: Negative samples file not exist");
+    }
   }
   // Train samples size.
   int size = sample_min_size;
@@ -272,6 +221,69 @@ void simple_image_train_cascade(Php::Parameters &params) {
     throw Php::Exception("Simple Image: Negative samples per step count must be greater than or equal to zero");
   }
   unsigned int negative_samples_per_step = temp_int;
+  // Training threads count.
+  // Zero means all hardware threads.
+  temp_int = 0;
+  if (params.size() > 8) {
+    temp_int = params[8];
+  }
+  if (temp_int < 0) {
+    throw Php::Exception("Simple Image: Threads count must be greater than or equal to zero");
+  }
+  ThreadPool thread_pool(resolve_threads_count(temp_int));
+  // Continue training from checkpoint, if it exists.
+  bool resume = false;
+  if (params.size() > 9) {
+    resume = params[9];
+  }
+  // Checkpoint is saved after each step next to model file.
+  string checkpoint_file_name = model_file_name + ".checkpoint";
+  training_checkpoint_state checkpoint_state;
+  bool resumed = resume && file_is_exist(checkpoint_file_name);
+  // Positive samples augmentation spec.
+  // Empty array means training on positive samples as they are.
+  augmentation_spec augmentation;
+  bool augment = false;
+  if (params.size() > 10) {
+    augment = read_augmentation_spec(params[10], augmentation);
+  }
+  // Boosting mode: discrete, real or gentle.
+  // Real and Gentle AdaBoost need less lookup table weakly classifiers per stage.
+  boosting_mode boosting = boosting_discrete;
+  if (params.size() > 11) {
+    boosting = boosting_mode_from_string(params[11].stringValue());
+  }
+  // Soft cascade carries score over stages and rejects windows after
+  // each weakly classifier.
+  bool soft = false;
+  if (params.size() > 12) {
+    soft = params[12];
+  }
+
+  // Training samples integral images are kept in memory blocks of pools.
+  SamplePool positive_pool(size, 0), negative_pool(size, 0);
+  CascadeClassifier *cascade_classifier;
+  // Negative samples are read from samples file or mined from background images.
+  unsigned int negative_source = background_files.empty() ? training_negative_samples_file : training_negative_background_images;
+  if (resumed) {
+    // Restore trained stages and samples sets before other training data is
+    // allocated, checkpoint mismatch has to destroy restored cascade only.
+    cascade_classifier = load_training_checkpoint(checkpoint_file_name, checkpoint_state, positive_pool, negative_pool);
+    string mismatch;
+    if (checkpoint_state.cascade_steps != cascade_steps) {
+      mismatch = "cascade steps count";
+    }
+    else if (cascade_classifier->isSoft() != soft) {
+      mismatch = "cascade mode";
+    }
+    else if (checkpoint_state.negative_source != negative_source) {
+      mismatch = "negative samples source";
+    }
+    if (!mismatch.empty()) {
+      destroy_cascade_classifier(cascade_classifier);
+      throw Php::Exception("Simple Image: Checkpoint has other " + mismatch);
+    }
+  }
 
   // Initialize train variables.
   // The maximum FNR.
@@ -284,46 +296,103 @@ void simple_image_train_cascade(Php::Parameters &params) {
   // Normalize sample flag.
   bool normalize = true;
 
-  // Loading positive samples file.
-  ifstream positive_file(positive_file_name);
-  // Read positive samples in vector.
-  string sample_line = "";
-  float *sample, *sample_2;
-  std::vector<float*> positive_samples, negative_samples;
-  while (getline(positive_file, sample_line)) {
-    if ((sample = read_sample_from_string(sample_line, size, size)) != NULL) {
-      // Reading sample success.
+  float *sample = new float[size * size];
+  // Load negative samples file, text or binary, or background images.
+  SampleReader *negative_reader = NULL;
+  BackgroundMiner *background_miner = NULL;
+  if (background_files.empty()) {
+    negative_reader = new SampleReader(negative_file_name, size, size);
+  }
+  else {
+    initialize_magick();
+    background_miner = new BackgroundMiner(background_files, size, normalize, rotation, &thread_pool);
+  }
+  int first_step = 0;
+
+  // Augmented training keeps raw base positive samples, pool gets their
+  // variants on every step.
+  PositiveAugmenter *positive_augmenter = NULL;
+  if (augment) {
+    SampleReader positive_reader(positive_file_name, size, size);
+    std::vector<float> base_samples;
+    while (positive_reader.read(sample)) {
+      base_samples.insert(base_samples.end(), sample, sample + size * size);
+    }
+    if (base_samples.empty()) {
+      throw Php::Exception("Simple Image: Empty positive samples set");
+    }
+    // Mirroring is made by augmenter instead of samples copies.
+    augmentation.mirroring = augmentation.mirroring || mirroring;
+    // Variants count is base samples count, if it's not specified.
+    if (augmentation.count == 0) {
+      augmentation.count = base_samples.size() / (size * size);
+    }
+    positive_augmenter = new PositiveAugmenter(base_samples, size, augmentation, normalize, &thread_pool);
+    positive_pool.reserve(augmentation.count);
+  }
+
+  if (resumed) {
+    // Continue training after restored stages and negative samples reading.
+    first_step = checkpoint_state.steps_done;
+    negative_samples_per_step = checkpoint_state.negative_samples_per_step;
+    if (background_miner != NULL) {
+      background_miner->seek(checkpoint_state.negative_position);
+    }
+    else {
+      negative_reader->seek(checkpoint_state.negative_position);
+    }
+  }
+  else if (positive_augmenter != NULL) {
+    // Set negative samples per step count to variants count, if it's not specified.
+    if (negative_samples_per_step == 0) {
+      negative_samples_per_step = augmentation.count;
+    }
+    cascade_classifier = new CascadeClassifier(size);
+    cascade_classifier->setSoft(soft);
+  }
+  else {
+    // Loading positive samples file, text or binary.
+    SampleReader positive_reader(positive_file_name, size, size);
+    // Read positive samples in vector.
+    std::vector<float*> raw_samples;
+    while (positive_reader.read(sample)) {
       // Normalize sample, if needed.
       if (normalize) {
         sample = normalize_sample(sample, size, size);
       }
-      // Save sample in positive_samples variable.
-      positive_samples.push_back(sample);
+      // Save sample in raw_samples variable.
+      raw_samples.push_back(sample);
+      sample = new float[size * size];
+    }
+    if (raw_samples.empty()) {
+      throw Php::Exception("Simple Image: Empty positive samples set");
     }
-  }
-  positive_file.close();
-  if (positive_samples.empty()) {
-    throw Php::Exception("Simple Image: Empty positive samples set");
-  }
 
-  // Create mirrors for positive samples, if needed.
-  if (mirroring) {
-    mirroring_samples(positive_samples, size, size);
-  }
-  // Set negative samples per step count to all (positive samples count),
-  // if it's not specified.
-  if (negative_samples_per_step == 0) {
-    negative_samples_per_step = positive_samples.size();
-  }
-  // Load negative samples file.
-  ifstream negative_file(negative_file_name);
-  sample_line = "";
+    // Create mirrors for positive samples, if needed.
+    if (mirroring) {
+      mirroring_samples(raw_samples, size, size);
+    }
+    // Set negative samples per step count to all (positive samples count),
+    // if it's not specified.
+    if (negative_samples_per_step == 0) {
+      negative_samples_per_step = raw_samples.size();
+    }
 
-  // Compute integral images for positive samples.
-  int positive_samples_count = positive_samples.size();
-  for (int i = 0; i < positive_samples_count; i++) {
-    positive_samples.push_back(compute_integral_image(positive_samples[i], size, size, false));
-    positive_samples.erase(positive_samples.begin());
+    // Compute integral images for positive samples, with zero first row and column as all training samples.
+    positive_pool.reserve(raw_samples.size());
+    for (unsigned int i = 0; i < raw_samples.size(); i++) {
+      positive_pool.add(raw_samples[i]);
+      delete[] raw_samples[i];
+    }
+    raw_samples.clear();
+    cascade_classifier = new CascadeClassifier(size);
+    cascade_classifier->setSoft(soft);
+  }
+  negative_pool.reserve(negative_samples_per_step);
+  // Negative samples are read by chunks and filtered by thread pool workers.
+  NegativeMiner *negative_miner = NULL;
+  if (negative_reader != NULL) {
+    negative_miner = new NegativeMiner(negative_reader, size, normalize, rotation, &thread_pool);
   }
 
   // Create features by sample sizes.
@@ -332,71 +401,186 @@ void simple_image_train_cascade(Php::Parameters &params) {
   float maximum_fpr = 1.0;
 
   // Building cascade classifier.
-  CascadeClassifier *cascade_classifier = new CascadeClassifier(size);
-  for (int k = 0; k < cascade_steps; k++) {
-    // Read negative sample from negative samples file.
-    if (negative_samples.size() < negative_samples_per_step) {
-      while (getline(negative_file, sample_line)) {
-        if ((sample = read_sample_from_string(sample_line, size, size)) != NULL) {
-          if (normalize) {
-            sample = normalize_sample(sample, size, size);
-          }
-
-          if (rotation) {
-            for (int rotation_index = 0; rotation_index < 4; rotation_index++) {
-              sample_2 = compute_integral_image(sample, size, size, false);
-              if (cascade_classifier->classifyImage(sample_2, size, 0, 0, 0, 1)) {
-                negative_samples.push_back(sample_2);
-                if (negative_samples.size() == negative_samples_per_step) {
-                  break;
-                }
-              }
-              if (rotation_index < 3) {
-                sample = sample_rotate_90(sample, size, size);
-              }
-            }
-            if (negative_samples.size() == negative_samples_per_step) {
-              break;
-            }
-          }
-          else {
-            sample = compute_integral_image(sample, size, size, false);
-            if (cascade_classifier->classifyImage(sample, size, 0, 0, 0, 1)) {
-              negative_samples.push_back(sample);
-              if (negative_samples.size() == negative_samples_per_step) {
-                break;
-              }
-            }
-          }
-        }
+  for (int k = first_step; k < cascade_steps; k++) {
+    // Make new positive variants, which pass current cascade.
+    if (positive_augmenter != NULL) {
+      positive_augmenter->fill(cascade_classifier, positive_pool, k);
+      if (positive_pool.size() == 0) {
+        break;
       }
     }
+    // Mine negative samples, which pass current cascade, from negative samples file or background images.
+    if (background_miner != NULL) {
+      background_miner->mine(cascade_classifier, negative_pool, negative_samples_per_step);
+    }
+    else {
+      negative_miner->mine(cascade_classifier, negative_pool, negative_samples_per_step);
+    }
 
-    if (negative_samples.size() > 0) {
+    if (negative_pool.size() > 0) {
       // Run AdaBoost algorithm to select best Haar features.
       maximum_fpr = current_fpr[k];
-      forceful_classifier = ada_boost(cascade_classifier, haar_features, positive_samples, negative_samples, maximum_fpr, maximum_fnr, size);
+      forceful_classifier = ada_boost(cascade_classifier, haar_features, positive_pool.samples(), negative_pool.samples(), maximum_fpr, maximum_fnr, size, boosting, &thread_pool);
       cascade_classifier->addClassifier(forceful_classifier);
       // Remove false detections from training.
-      for (unsigned int i = 0; i < negative_samples.size(); i++) {
-        if (!forceful_classifier->classifyImage(negative_samples[i], size, 0, 0, 0, 1)) {
-          negative_samples.erase(negative_samples.begin() + i);
+      for (unsigned int i = 0; i < negative_pool.size(); i++) {
+        if (!(soft ? cascade_classifier->classifyImage(negative_pool.sample(i), size + 1, 1, 1, 0, 1) : forceful_classifier->classifyImage(negative_pool.sample(i), size + 1, 1, 1, 0, 1))) {
+          negative_pool.remove(i);
           i--;
         }
       }
-      for (unsigned int i = 0; i < positive_samples.size(); i++) {
-        if (!forceful_classifier->classifyImage(positive_samples[i], size, 0, 0, 0, 1)) {
-          positive_samples.erase(positive_samples.begin() + i);
+      for (unsigned int i = 0; i < positive_pool.size(); i++) {
+        if (!(soft ? cascade_classifier->classifyImage(positive_pool.sample(i), size + 1, 1, 1, 0, 1) : forceful_classifier->classifyImage(positive_pool.sample(i), size + 1, 1, 1, 0, 1))) {
+          positive_pool.remove(i);
           i--;
         }
       }
+      // Save checkpoint of trained step.
+      checkpoint_state.size = size;
+      checkpoint_state.steps_done = k + 1;
+      checkpoint_state.cascade_steps = cascade_steps;
+      checkpoint_state.negative_samples_per_step = negative_samples_per_step;
+      checkpoint_state.negative_position = background_miner != NULL ? background_miner->position() : negative_reader->position();
+      checkpoint_state.negative_source = negative_source;
+      if (!save_training_checkpoint(checkpoint_file_name, checkpoint_state, cascade_classifier, positive_pool, negative_pool)) {
+        throw Php::Exception("Simple Image: Training checkpoint can not be saved");
+      }
     }
     else {
       break;
     }
   }
-  negative_file.close();
-  cascade_classifier->save(model_file_name);
+  delete[] sample;
+  delete positive_augmenter;
+  delete negative_miner;
+  delete negative_reader;
+  delete background_miner;
+  if (!cascade_classifier->save(model_file_name)) {
+    // Checkpoint is kept to save trained model by resumed training.
+    throw Php::Exception("Simple Image: Model file can not be saved");
+  }
+  // Trained model is saved, checkpoint is not needed anymore.
+  remove(checkpoint_file_name.c_str());
+}
+
+// Object detection options structure.
+struct detection_options {
+  float scale_step;
+  float slide_step;
+  float scale_value;
+  int threads_count;
+  bool pyramid;
+};
+
+/**
+ * Read object detection options from params, starting from given index.
+ */
+detection_options read_detection_options(Php::Parameters &params, unsigned int first_index) {
+  detection_options options;
+  double temp_double;
+  // Scale step value.
+  options.scale_step = 1.25;
+  if (params.size() > first_index) {
+    temp_double = params[first_index];
+    options.scale_step = (float) temp_double;
+  }
+  if (options.scale_step <= 1) {
+    throw Php::Exception("Simple Image: Scale step must be greater than one");
+  }
+  // Slide step value.
+  options.slide_step = 0.1;
+  if (params.size() > first_index + 1) {
+    temp_double = params[first_index + 1];
+    options.slide_step = (float) temp_double;
+  }
+  // Classifiers limit scale value, defaults to 1.
+  options.scale_value = 1;
+  if (params.size() > first_index + 2) {
+    temp_double = params[first_index + 2];
+    options.scale_value = (float) temp_double;
+  }
+  // Detection threads count.
+  // Zero means all hardware threads.
+  options.threads_count = 0;
+  if (params.size() > first_index + 3) {
+    options.threads_count = params[first_index + 3];
+  }
+  if (options.threads_count < 0) {
+    throw Php::Exception("Simple Image: Threads count must be greater than or equal to zero");
+  }
+  // Detect on image pyramid instead of scaling classifier.
+  options.pyramid = false;
+  if (params.size() > first_index + 4) {
+    options.pyramid = params[first_index + 4];
+  }
+  return options;
+}
+
+/**
+ * Detect objects on image and put them in detection manager.
+ */
+void detect_image_objects(Image image, CompiledCascade *compiled_cascade, detection_options &options, DetectionManager *detection_manager) {
+  unsigned int rows = image.rows(), columns = image.columns();
+  ThreadPool *thread_pool = detection_thread_pool(resolve_threads_count(options.threads_count));
+  image.type(GrayscaleType);
+
+  if (options.pyramid) {
+    // Start object detection over all pyramid levels.
+    std::vector<float> image_shade_pixels(rows * columns);
+    image_pixels_shade(image, image_shade_pixels.data());
+    PyramidDetectionEngine detection_engine(compiled_cascade, columns, rows, options.scale_step, options.slide_step, options.scale_value);
+    detection_engine.detect(image_shade_pixels.data(), thread_pool, detection_manager);
+  }
+  else {
+    // Calculate integral and squared integral image from image pixels shade.
+    IntegralTable integral_image(columns, rows), squared_integral_image(columns, rows);
+    image_integral_images(image, integral_image.data(), squared_integral_image.data());
+
+    // Start object detection over all scales.
+    DetectionEngine detection_engine(compiled_cascade, columns, rows, options.scale_step, options.slide_step, options.scale_value);
+    detection_engine.detect(integral_image.data(), squared_integral_image.data(), thread_pool, detection_manager);
+  }
+}
+
+/**
+ * Detect objects on raw grayscale buffer and put them in detection manager.
+ *
+ * Buffer holds rows of float pixels in [0, 1] range or of 8 bit pixels.
+ * Float pixels are used in place, 8 bit pixels are converted row by row,
+ * when integral images are computed, and at once for image pyramid.
+ */
+void detect_raw_objects(const char *data, bool bytes, unsigned int columns, unsigned int rows, CompiledCascade *compiled_cascade, detection_options &options, DetectionManager *detection_manager) {
+  ThreadPool *thread_pool = detection_thread_pool(resolve_threads_count(options.threads_count));
+
+  if (options.pyramid) {
+    // Start object detection over all pyramid levels.
+    std::vector<float> image_shade_pixels;
+    const float *pixels = (const float*) data;
+    if (bytes) {
+      image_shade_pixels.resize(rows * columns);
+      for (unsigned int i = 0; i < rows * columns; i++) {
+        image_shade_pixels[i] = (unsigned char) data[i] / 255.0f;
+      }
+      pixels = image_shade_pixels.data();
+    }
+    PyramidDetectionEngine detection_engine(compiled_cascade, columns, rows, options.scale_step, options.slide_step, options.scale_value);
+    detection_engine.detect(pixels, thread_pool, detection_manager);
+  }
+  else {
+    // Calculate integral and squared integral image from buffer.
+    IntegralTable integral_image(columns, rows), squared_integral_image(columns, rows);
+    IntegralImages integral_images(columns, integral_image.data(), squared_integral_image.data());
+    if (bytes) {
+      integral_images.addRows((const unsigned char*) data, rows);
+    }
+    else {
+      integral_images.addRows((const float*) data, rows);
+    }
+
+    // Start object detection over all scales.
+    DetectionEngine detection_engine(compiled_cascade, columns, rows, options.scale_step, options.slide_step, options.scale_value);
+    detection_engine.detect(integral_image.data(), squared_integral_image.data(), thread_pool, detection_manager);
+  }
 }
 
 /**
@@ -417,81 +601,21 @@ Php::Value simple_image_classify_image(Php::Parameters &params) {
   if (params.size() > 2) {
     show_detections = params[2];
   }
-  // Scale step value.
-  float scale_step = 1.25;
-  double temp_double;
-  if (params.size() > 3) {
-    temp_double = params[3];
-    scale_step = (float) temp_double;
-  }
-  // Slide step value.
-  float slide_step = 0.1;
-  if (params.size() > 4) {
-    temp_double = params[4];
-    slide_step = (float) temp_double;
-  }
-  // Classifiers limit scale value, defaults to 1.
-  float scale_value = 1;
-  if (params.size() > 5) {
-    temp_double = params[5];
-    scale_value = (float) temp_double;
-  }
+  detection_options options = read_detection_options(params, 3);
 
-  // Load classifier from file.
-  CascadeClassifier *cascade_classifier = load_cascade_classifier_from_file(classifier_file_name);
-  cascade_classifier->scaleClassifiersLimitByValue(scale_value);
+  // Get classifier from models cache.
+  std::shared_ptr<CompiledCascade> compiled_cascade = model_cache()->get(classifier_file_name);
 
   // Initialize Magick++.
-  InitializeMagick("");
-  Image image, temp_image;
+  initialize_magick();
+  Image image;
   try {
     // Load image file.
     image.read(image_file_name);
-    temp_image = image;
 
-    // Definition of helpful variables.
+    // Detect objects on image copy.
     DetectionManager *detection_manager = new DetectionManager();
-    float *image_shade_pixels, *integral_image, *squared_integral_image;
-    unsigned int rows = image.rows(), columns = image.columns(), size = cascade_classifier->getSize();
-    float temp1, temp2;
-    int slide;
-
-    // Calculate image pixels shade array.
-    image_shade_pixels = new float[rows * columns];
-    temp_image.type(GrayscaleType);
-    for (unsigned int x = 0; x < rows; x++) {
-      for (unsigned int y = 0; y < columns; y++) {
-        ColorGray color = temp_image.pixelColor(x, y);
-        image_shade_pixels[x * columns + y] = color.shade();
-      }
-    }
-
-    // Calculate integral and squared integral image and squared integral image
-    integral_image = compute_integral_image(image_shade_pixels, columns, rows, false);
-    squared_integral_image = compute_integral_image(image_shade_pixels, columns, rows, true);
-
-    // Start object detection.
-    while (size <= rows && size <= columns) {
-      slide = size * slide_step;
-      if (slide < 1) {
-        slide = 1;
-      }
-      // Slide window over image
-      for (unsigned int x = 0; (x + size) <= columns; x += slide) {
-        for (unsigned int y = 0; (y + size) <= rows; y += slide) {
-          // Calculate variables for current window.
-          temp1 = calculate_integral_rectangle(integral_image, columns, x, y, size, size) / pow(size, 2);
-          temp2 = sqrt((calculate_integral_rectangle(squared_integral_image, columns, x, y, size, size) / pow(size, 2)) - pow(temp1, 2));
-          // Classify window by calculated values.
-          if (cascade_classifier->classifyImage(integral_image, columns, x, y, temp1, temp2)) {
-            detection_manager->addDetection(x, y, size);
-          }
-        }
-      }
-      // Scale cascade classifier.
-      cascade_classifier->scaleByValue(scale_step);
-      size = cascade_classifier->getSize();
-    }
+    detect_image_objects(image, compiled_cascade.get(), options, detection_manager);
 
     // Load detections count.
     result = detection_manager->count();
@@ -509,9 +633,7 @@ Php::Value simple_image_classify_image(Php::Parameters &params) {
     }
 
     // Remove arrays from memory.
-    delete[] image_shade_pixels;
-    delete[] integral_image;
-    delete[] squared_integral_image;
+    delete detection_manager;
   }
   catch (Exception &error) {
     throw Php::Exception(error.what());
@@ -519,8 +641,358 @@ Php::Value simple_image_classify_image(Php::Parameters &params) {
   return result;
 }
 
+/**
+ * Convert grouped detections to array of boxes.
+ */
+Php::Value detection_groups_to_array(std::vector<detection_group> groups) {
+  Php::Value result = Php::Array();
+  for (unsigned int i = 0; i < groups.size(); i++) {
+    Php::Value box;
+    box["x"] = (int64_t) groups[i].x;
+    box["y"] = (int64_t) groups[i].y;
+    box["width"] = (int64_t) groups[i].size;
+    box["height"] = (int64_t) groups[i].size;
+    box["neighbors"] = (int64_t) groups[i].neighbors;
+    box["confidence"] = (double) groups[i].confidence;
+    result[i] = box;
+  }
+  return result;
+}
+
+/**
+ * Detect objects on image, get grouped detections boxes.
+ *
+ * Overlapping raw detections are grouped, every box has neighbors count
+ * and confidence, the best last stage margin in group.
+ */
+Php::Value simple_image_detect_objects(Php::Parameters &params) {
+  Php::Value result;
+  // Search image file name.
+  string image_file_name = params[0];
+  if (!file_is_exist(image_file_name)) {
+    throw Php::Exception("Simple Image: Image file not exist");
+  }
+  // Classifier file name.
+  string classifier_file_name = params[1];
+  // Min raw detections count in group.
+  int min_neighbors = 1;
+  if (params.size() > 2) {
+    min_neighbors = params[2];
+  }
+  if (min_neighbors < 1) {
+    throw Php::Exception("Simple Image: Min neighbors must be greater than zero");
+  }
+  detection_options options = read_detection_options(params, 3);
+
+  // Get classifier from models cache.
+  std::shared_ptr<CompiledCascade> compiled_cascade = model_cache()->get(classifier_file_name);
+
+  // Initialize Magick++.
+  initialize_magick();
+  Image image;
+  try {
+    // Load image file.
+    image.read(image_file_name);
+
+    DetectionManager detection_manager;
+    detect_image_objects(image, compiled_cascade.get(), options, &detection_manager);
+    result = detection_groups_to_array(detection_manager.group(min_neighbors));
+  }
+  catch (Exception &error) {
+    throw Php::Exception(error.what());
+  }
+  return result;
+}
+
+/**
+ * Detect objects on image given in memory, get grouped detections boxes.
+ *
+ * Without width and height buffer is encoded image in any format, known
+ * to Magick++. With them buffer is raw grayscale image, one byte or one
+ * float per pixel, row by row, and it is not copied.
+ */
+Php::Value simple_image_detect_objects_in_buffer(Php::Parameters &params) {
+  Php::Value result;
+  // Image buffer.
+  const char *data = params[0].rawValue();
+  size_t data_size = params[0].size();
+  if (data_size == 0) {
+    throw Php::Exception("Simple Image: Image buffer is empty");
+  }
+  // Classifier file name.
+  string classifier_file_name = params[1];
+  // Raw image sizes, zero for encoded image.
+  // Width without height is not ignored.
+  int columns = 0, rows = 0;
+  if (params.size() > 3) {
+    columns = params[2];
+    rows = params[3];
+  }
+  if (params.size() == 3 || columns < 0 || rows < 0 || (columns == 0) != (rows == 0)) {
+    throw Php::Exception("Simple Image: Raw image width and height must be both positive or both zero");
+  }
+  bool raw = columns > 0;
+  if (raw && data_size != (size_t) columns * rows && data_size != (size_t) columns * rows * sizeof(float)) {
+    throw Php::Exception("Simple Image: Raw image buffer size does not match width and height");
+  }
+  // Min raw detections count in group.
+  int min_neighbors = 1;
+  if (params.size() > 4) {
+    min_neighbors = params[4];
+  }
+  if (min_neighbors < 1) {
+    throw Php::Exception("Simple Image: Min neighbors must be greater than zero");
+  }
+  detection_options options = read_detection_options(params, 5);
+
+  // Get classifier from models cache.
+  std::shared_ptr<CompiledCascade> compiled_cascade = model_cache()->get(classifier_file_name);
+
+  DetectionManager detection_manager;
+  if (raw) {
+    detect_raw_objects(data, data_size == (size_t) columns * rows, columns, rows, compiled_cascade.get(), options, &detection_manager);
+  }
+  else {
+    // Initialize Magick++.
+    initialize_magick();
+    Image image;
+    try {
+      // Decode image from buffer.
+      image.read(Blob(data, data_size));
+      detect_image_objects(image, compiled_cascade.get(), options, &detection_manager);
+    }
+    catch (Exception &error) {
+      throw Php::Exception(error.what());
+    }
+  }
+  result = detection_groups_to_array(detection_manager.group(min_neighbors));
+  return result;
+}
+
+/**
+ * Detect objects on many images by one model.
+ *
+ * Images are decoded by decoder threads and detected by detection thread
+ * pool at the same time. Result has the same keys as files array, every
+ * item has raw detections count and grouped objects boxes, or error
+ * message, when image can not be read.
+ */
+Php::Value simple_image_classify_images(Php::Parameters &params) {
+  Php::Value result = Php::Array();
+  // Files names and their keys.
+  std::vector<Php::Value> keys;
+  std::vector<string> files;
+  for (auto &iterator : params[0]) {
+    keys.push_back(iterator.first);
+    files.push_back(iterator.second.stringValue());
+  }
+  // Classifier file name.
+  string classifier_file_name = params[1];
+  // Min raw detections count in group.
+  int min_neighbors = 1;
+  if (params.size() > 2) {
+    min_neighbors = params[2];
+  }
+  if (min_neighbors < 1) {
+    throw Php::Exception("Simple Image: Min neighbors must be greater than zero");
+  }
+  detection_options options = read_detection_options(params, 3);
+  // Decoder threads count.
+  // Zero means a quarter of detection threads, at least one.
+  int decoders_count = 0;
+  if (params.size() > 8) {
+    decoders_count = params[8];
+  }
+  if (decoders_count < 0) {
+    throw Php::Exception("Simple Image: Decode threads count must be greater than or equal to zero");
+  }
+
+  // Get classifier from models cache.
+  std::shared_ptr<CompiledCascade> compiled_cascade = model_cache()->get(classifier_file_name);
+
+  // Initialize Magick++.
+  initialize_magick();
+  ThreadPool *thread_pool = detection_thread_pool(resolve_threads_count(options.threads_count));
+  if (decoders_count == 0) {
+    decoders_count = thread_pool->size() / 4 > 0 ? thread_pool->size() / 4 : 1;
+  }
+  DetectionPipeline pipeline(compiled_cascade.get(), options.scale_step, options.slide_step, options.scale_value, options.pyramid, thread_pool, decoders_count);
+  pipeline.run(files, [&](unsigned int index, DetectionManager &detection_manager) {
+    Php::Value item;
+    item["count"] = (int64_t) detection_manager.count();
+    item["objects"] = detection_groups_to_array(detection_manager.group(min_neighbors));
+    result[keys[index]] = item;
+  }, [&](unsigned int index, const std::string &error) {
+    Php::Value item;
+    item["error"] = error;
+    result[keys[index]] = item;
+  });
+  return result;
+}
+
+/**
+ * Profile object detection on image by cascade classifier model.
+ *
+ * Result has windows count, accepted windows count and average evaluated
+ * weakly classifiers per window, for whole detection and for every scale,
+ * scales detection time and windows count, that entered and passed every
+ * stage. Only scaled classifier detection is profiled.
+ */
+Php::Value simple_image_profile_image(Php::Parameters &params) {
+  Php::Value result;
+  // Search image file name.
+  string image_file_name = params[0];
+  if (!file_is_exist(image_file_name)) {
+    throw Php::Exception("Simple Image: Image file not exist");
+  }
+  // Classifier file name.
+  string classifier_file_name = params[1];
+  detection_options options = read_detection_options(params, 2);
+
+  // Get classifier from models cache.
+  std::shared_ptr<CompiledCascade> compiled_cascade = model_cache()->get(classifier_file_name);
+
+  // Initialize Magick++.
+  initialize_magick();
+  Image image;
+  std::vector<scale_profile> profiles;
+  try {
+    // Load image file.
+    image.read(image_file_name);
+    unsigned int rows = image.rows(), columns = image.columns();
+    image.type(GrayscaleType);
+
+    // Calculate integral and squared integral image from image pixels shade.
+    IntegralTable integral_image(columns, rows), squared_integral_image(columns, rows);
+    image_integral_images(image, integral_image.data(), squared_integral_image.data());
+
+    // Profile object detection over all scales.
+    DetectionEngine detection_engine(compiled_cascade.get(), columns, rows, options.scale_step, options.slide_step, options.scale_value);
+    detection_engine.profile(integral_image.data(), squared_integral_image.data(), detection_thread_pool(resolve_threads_count(options.threads_count)), profiles);
+  }
+  catch (Exception &error) {
+    throw Php::Exception(error.what());
+  }
+
+  // Collect statistics of all scales.
+  Php::Value scales = Php::Array(), stages = Php::Array();
+  cascade_stats stats;
+  double seconds = 0;
+  unsigned int stages_count = compiled_cascade->stagesCount();
+  reset_cascade_stats(stats, stages_count);
+  for (unsigned int i = 0; i < profiles.size(); i++) {
+    Php::Value scale;
+    unsigned long long accepted = stages_count > 0 ? profiles[i].stats.stage_passed[stages_count - 1] : profiles[i].stats.windows;
+    scale["size"] = (int64_t) profiles[i].size;
+    scale["windows"] = (int64_t) profiles[i].stats.windows;
+    scale["accepted"] = (int64_t) accepted;
+    scale["average_weakly"] = profiles[i].stats.windows > 0 ? (double) profiles[i].stats.weakly_evaluated / profiles[i].stats.windows : 0.0;
+    scale["seconds"] = profiles[i].seconds;
+    scales[i] = scale;
+    merge_cascade_stats(stats, profiles[i].stats);
+    seconds += profiles[i].seconds;
+  }
+  unsigned int *stage_first = compiled_cascade->getArrays().stage_first;
+  unsigned long long entered = stats.windows;
+  for (unsigned int i = 0; i < stages_count; i++) {
+    Php::Value stage;
+    stage["weakly"] = (int64_t) (stage_first[i + 1] - stage_first[i]);
+    stage["entered"] = (int64_t) entered;
+    stage["passed"] = (int64_t) stats.stage_passed[i];
+    stage["pass_rate"] = entered > 0 ? (double) stats.stage_passed[i] / entered : 0.0;
+    stages[i] = stage;
+    entered = stats.stage_passed[i];
+  }
+  result["windows"] = (int64_t) stats.windows;
+  result["accepted"] = (int64_t) entered;
+  result["average_weakly"] = stats.windows > 0 ? (double) stats.weakly_evaluated / stats.windows : 0.0;
+  result["seconds"] = seconds;
+  result["scales"] = scales;
+  result["stages"] = stages;
+  return result;
+}
+
+/**
+ * Load model in models cache.
+ */
+void simple_image_load_model(Php::Parameters &params) {
+  // Classifier file name.
+  string classifier_file_name = params[0];
+  model_cache()->get(classifier_file_name);
+}
+
+/**
+ * Remove model from models cache.
+ */
+Php::Value simple_image_unload_model(Php::Parameters &params) {
+  // Classifier file name.
+  string classifier_file_name = params[0];
+  return model_cache()->remove(classifier_file_name);
+}
+
+/**
+ * Get models cache statistics.
+ */
+Php::Value simple_image_model_cache_stats() {
+  Php::Value result;
+  ModelCache *cache = model_cache();
+  result["hits"] = (int64_t) cache->hits();
+  result["misses"] = (int64_t) cache->misses();
+  result["models"] = (int64_t) cache->size();
+  return result;
+}
+
+/**
+ * Convert text model file to binary model file.
+ */
+void simple_image_convert_model(Php::Parameters &params) {
+  // Text model file name.
+  string text_model_file_name = params[0];
+  // Binary model file name.
+  string binary_model_file_name = params[1];
+
+  CompiledCascade *compiled_cascade = load_compiled_cascade_from_file(text_model_file_name);
+  bool saved = compiled_cascade->save(binary_model_file_name);
+  delete compiled_cascade;
+  if (!saved) {
+    throw Php::Exception("Simple Image: Binary model file can not be saved");
+  }
+}
+
+/**
+ * Convert samples file to other format.
+ */
+void simple_image_convert_samples(Php::Parameters &params) {
+  // Input samples file name.
+  string input_file_name = params[0];
+  if (!file_is_exist(input_file_name)) {
+    throw Php::Exception("Simple Image: Samples file not exist");
+  }
+  // Output samples file name.
+  string output_file_name = params[1];
+  // Output samples format: text, float or uint8.
+  string format_name = params[2];
+  sample_store_format format = sample_format_from_string(format_name);
+  // Samples size, needed for text input file only.
+  int size = 0;
+  if (params.size() > 3) {
+    size = params[3];
+  }
+
+  SampleReader reader(input_file_name, size, size);
+  SampleWriter writer(output_file_name, reader.width(), reader.height(), format);
+  std::vector<float> sample(reader.width() * reader.height());
+  while (reader.read(sample.data())) {
+    writer.write(sample.data());
+  }
+  writer.close();
+}
+
 /**
  * Create samples for cascade training.
+ *
+ * Samples are created in parallel, every sample has own random generator
+ * derived from seed, so the same seed gives the same samples files.
  */
 void simple_image_create_samples(Php::Parameters &params) {
   // Output file name (file with positive samples for training).
@@ -559,15 +1031,42 @@ void simple_image_create_samples(Php::Parameters &params) {
   if (size < sample_min_size || size > sample_max_size) {
     throw Php::Exception("Simple Image: Samples size must be >= " + std::to_string(sample_min_size) + " and <= " + std::to_string(sample_max_size));
   }
+  // Samples files format: text, float or uint8.
+  string format_name = "text";
+  if (params.size() > 6) {
+    format_name = params[6].stringValue();
+  }
+  sample_store_format format = sample_format_from_string(format_name);
+  // Generation threads count.
+  // Zero means all hardware threads.
+  int temp_int = 0;
+  if (params.size() > 7) {
+    temp_int = params[7];
+  }
+  if (temp_int < 0) {
+    throw Php::Exception("Simple Image: Threads count must be greater than or equal to zero");
+  }
+  ThreadPool thread_pool(resolve_threads_count(temp_int));
+  // Random seed, the same seed gives the same samples.
+  // Zero means random seed.
+  long long seed = 0;
+  if (params.size() > 8) {
+    seed = params[8].numericValue();
+  }
+  if (seed < 0) {
+    throw Php::Exception("Simple Image: Seed must be greater than or equal to zero");
+  }
+  if (seed == 0) {
+    seed = std::random_device()();
+  }
 
   // Initialize Magick++.
-  InitializeMagick("");
+  initialize_magick();
+  SampleGenerator sample_generator(size, seed, &thread_pool);
   // Define search image variable.
   Image search_image, temp_image;
-  // Define background images vector.
-  std::vector<Image> background_images;
-  // Define file for output.
-  fstream positive_file, negative_file;
+  // Define source pixels vectors.
+  std::vector<std::vector<float> > background_images, search_images;
 
   try {
     // Load search image file.
@@ -577,10 +1076,6 @@ void simple_image_create_samples(Php::Parameters &params) {
       throw Php::Exception("Simple Image: Too small size of search image");
     }
 
-    // Open output files (if files now exists, they would be create).
-    negative_file.open(negative_output_file_name, fstream::out);
-
-    bool negative_files_exists = false;
     // Iterate negative images.
     for (auto const& file_path: negative_images_list) {
       // Check, that background image exist.
@@ -589,82 +1084,29 @@ void simple_image_create_samples(Php::Parameters &params) {
         temp_image = Image(file_path);
         // Check minimal image size.
         if (temp_image.size().width() >= min_size && temp_image.size().height() >= min_size) {
-          // Crop negative image by min size.
-          temp_image = image_crop_by_min_size(temp_image);
-          negative_files_exists = true;
-          // Put image object in vector.
-          background_images.push_back(temp_image);
+          // Crop and downsample negative image once, before effects.
+          background_images.push_back(sample_generator.prepareImage(temp_image));
         }
       }
     }
-
-    // Noises array variations.
-    NoiseType noise_types[6] = {UniformNoise, GaussianNoise, MultiplicativeGaussianNoise, ImpulseNoise, LaplacianNoise, PoissonNoise};
-
-    for (int i = 0; i < count * 2; i++) {
-      temp_image = background_images[random_int(0, background_images.size() - 1)];
-      // Try blur image.
-      if ((bool) random_int(0, 1)) {
-        temp_image.blur(random_int(0, 10), (float) 1 / random_int(1, 10));
-      }
-      if ((bool) random_int(0, 1)) {
-        temp_image.shade(random_int(15, 70), random_int(15, 70), false);
-      }
-      // Try add noise to image.
-      if ((bool) random_int(0, 1)) {
-        temp_image.addNoise(noise_types[random_int(0, 5)]);
-      }
-      // Use gray-scale filter.
-      // Scale search image to new size.
-      temp_image.scale(Geometry(size, size));
-      temp_image.type(GrayscaleType);
-
-      // Output negative sample pixels values to file.
-      negative_file << image_pixels_shade_to_string(temp_image);
-      negative_file << endl;
+    // If all background images not exists, throw exception.
+    if (background_images.empty()) {
+      throw Php::Exception("Simple Image: All negative images not exists or have too small size");
     }
 
+    // Open output files (if files now exists, they would be create).
+    SampleWriter negative_file(negative_output_file_name, size, size, format);
+    // Generate negative samples.
+    sample_generator.generate(background_images, sample_stream_negative, false, count * 2, negative_file);
     // Close output files.
     negative_file.close();
 
-    // If all background images not exists, throw exception.
-    if (!negative_files_exists) {
-      throw Php::Exception("Simple Image: All negative images not exists or have too small size");
-    }
-
     // Open output files (if files now exists, they would be create).
-    positive_file.open(positive_output_file_name, fstream::out);
-    // Crop search image by min size.
-    search_image = image_crop_by_min_size(search_image);
-    // Generate positive samples.
-    for (int i = 0; i < count; i++) {
-      // Copy search image in temp variable.
-      temp_image = search_image;
-
-      // Rotate search image.
-      temp_image.rotate(random_int(-25, 25));
-      // Try blur image.
-      if ((bool) random_int(0, 1)) {
-        temp_image.blur(random_int(0, 10), (float) 1 / random_int(1, 10));
-      }
-      if ((bool) random_int(0, 1)) {
-        temp_image.shade(random_int(15, 70), random_int(15, 70), false);
-      }
-      // Try add noise to image.
-      if ((bool) random_int(0, 1)) {
-        temp_image.addNoise(noise_types[random_int(0, 5)]);
-      }
-      // Use gray-scale filter.
-      // Scale search image to new size.
-      temp_image.scale(Geometry(size, size));
-      temp_image.type(GrayscaleType);
-
-      // Output positive sample pixels values to file.
-      positive_file << image_pixels_shade_to_string(temp_image);
-      if (i != (count - 1)) {
-        positive_file << endl;
-      }
-    }
+    SampleWriter positive_file(positive_output_file_name, size, size, format);
+    // Crop and downsample search image once, before effects.
+    search_images.push_back(sample_generator.prepareImage(search_image));
+    // Generate rotated positive samples.
+    sample_generator.generate(search_images, sample_stream_positive, true, count, positive_file);
     // Close output files.
     positive_file.close();
   }
@@ -698,19 +1140,27 @@ extern "C" {
       Php::ByVal("image_file_name", Php::Type::String, true),
       Php::ByVal("negative_images_list", Php::Type::Array, true),
       Php::ByVal("count", Php::Type::Numeric, false),
-      Php::ByVal("size", Php::Type::Numeric, false)
+      Php::ByVal("size", Php::Type::Numeric, false),
+      Php::ByVal("format", Php::Type::String, false),
+      Php::ByVal("threads", Php::Type::Numeric, false),
+      Php::ByVal("seed", Php::Type::Numeric, false)
     });
 
     // Add training function to extension.
     extension.add<simple_image_train_cascade>("simple_image_train_cascade", {
       Php::ByVal("model_file_name", Php::Type::String, true),
       Php::ByVal("positive_file_name", Php::Type::String, true),
-      Php::ByVal("negative_file_name", Php::Type::String, true),
+      Php::ByVal("negative_file_name", Php::Type::Null, true),
       Php::ByVal("size", Php::Type::Numeric, false),
       Php::ByVal("cascade_steps", Php::Type::Numeric, false),
       Php::ByVal("rotation", Php::Type::Bool, false),
       Php::ByVal("mirroring", Php::Type::Bool, false),
-      Php::ByVal("negative_samples_per_step", Php::Type::Numeric, false)
+      Php::ByVal("negative_samples_per_step", Php::Type::Numeric, false),
+      Php::ByVal("threads", Php::Type::Numeric, false),
+      Php::ByVal("resume", Php::Type::Bool, false),
+      Php::ByVal("augmentation", Php::Type::Array, false),
+      Php::ByVal("boosting", Php::Type::String, false),
+      Php::ByVal("soft_cascade", Php::Type::Bool, false)
     });
 
     // Add classify function to extension.
@@ -720,7 +1170,74 @@ extern "C" {
       Php::ByVal("show_detections", Php::Type::Bool, false),
       Php::ByVal("scale_step", Php::Type::Float, false),
       Php::ByVal("slide_step", Php::Type::Float, false),
-      Php::ByVal("scale_value", Php::Type::Float, false)
+      Php::ByVal("scale_value", Php::Type::Float, false),
+      Php::ByVal("threads", Php::Type::Numeric, false),
+      Php::ByVal("pyramid", Php::Type::Bool, false)
+    });
+    // Add object detection in memory buffer function to extension.
+    extension.add<simple_image_detect_objects_in_buffer>("simple_image_detect_objects_in_buffer", {
+      Php::ByVal("image_buffer", Php::Type::String, true),
+      Php::ByVal("classifier_file_name", Php::Type::String, true),
+      Php::ByVal("width", Php::Type::Numeric, false),
+      Php::ByVal("height", Php::Type::Numeric, false),
+      Php::ByVal("min_neighbors", Php::Type::Numeric, false),
+      Php::ByVal("scale_step", Php::Type::Float, false),
+      Php::ByVal("slide_step", Php::Type::Float, false),
+      Php::ByVal("scale_value", Php::Type::Float, false),
+      Php::ByVal("threads", Php::Type::Numeric, false),
+      Php::ByVal("pyramid", Php::Type::Bool, false)
+    });
+    // Add detection profiling function to extension.
+    extension.add<simple_image_profile_image>("simple_image_profile_image", {
+      Php::ByVal("image_file_name", Php::Type::String, true),
+      Php::ByVal("classifier_file_name", Php::Type::String, true),
+      Php::ByVal("scale_step", Php::Type::Float, false),
+      Php::ByVal("slide_step", Php::Type::Float, false),
+      Php::ByVal("scale_value", Php::Type::Float, false),
+      Php::ByVal("threads", Php::Type::Numeric, false)
+    });
+    // Add batch classification function to extension.
+    extension.add<simple_image_classify_images>("simple_image_classify_images", {
+      Php::ByVal("image_file_names", Php::Type::Array, true),
+      Php::ByVal("classifier_file_name", Php::Type::String, true),
+      Php::ByVal("min_neighbors", Php::Type::Numeric, false),
+      Php::ByVal("scale_step", Php::Type::Float, false),
+      Php::ByVal("slide_step", Php::Type::Float, false),
+      Php::ByVal("scale_value", Php::Type::Float, false),
+      Php::ByVal("threads", Php::Type::Numeric, false),
+      Php::ByVal("pyramid", Php::Type::Bool, false),
+      Php::ByVal("decode_threads", Php::Type::Numeric, false)
+    });
+    // Add object detection function to extension.
+    extension.add<simple_image_detect_objects>("simple_image_detect_objects", {
+      Php::ByVal("image_file_name", Php::Type::String, true),
+      Php::ByVal("classifier_file_name", Php::Type::String, true),
+      Php::ByVal("min_neighbors", Php::Type::Numeric, false),
+      Php::ByVal("scale_step", Php::Type::Float, false),
+      Php::ByVal("slide_step", Php::Type::Float, false),
+      Php::ByVal("scale_value", Php::Type::Float, false),
+      Php::ByVal("threads", Php::Type::Numeric, false),
+      Php::ByVal("pyramid", Php::Type::Bool, false)
+    });
+    // Add samples convert function to extension.
+    extension.add<simple_image_convert_samples>("simple_image_convert_samples", {
+      Php::ByVal("input_file_name", Php::Type::String, true),
+      Php::ByVal("output_file_name", Php::Type::String, true),
+      Php::ByVal("format", Php::Type::String, true),
+      Php::ByVal("size", Php::Type::Numeric, false)
+    });
+    // Add model cache functions to extension.
+    extension.add<simple_image_load_model>("simple_image_load_model", {
+      Php::ByVal("classifier_file_name", Php::Type::String, true)
+    });
+    extension.add<simple_image_unload_model>("simple_image_unload_model", {
+      Php::ByVal("classifier_file_name", Php::Type::String, true)
+    });
+    extension.add<simple_image_model_cache_stats>("simple_image_model_cache_stats");
+    // Add model convert function to extension.
+    extension.add<simple_image_convert_model>("simple_image_convert_model", {
+      Php::ByVal("text_model_file_name", Php::Type::String, true),
+      Php::ByVal("binary_model_file_name", Php::Type::String, true)
     });
 
     // Return the extension